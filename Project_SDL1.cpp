@@ -1,501 +1,3251 @@
 #include "Project_SDL1.h"
 #include <algorithm>
 #include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstring>
 #include <cstdlib>
+#include <fstream>
 #include <numeric>
 #include <random>
 #include <string>
+//Snapshots are mapped rather than read
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+//Vector width of the movement kernel, scalar only if none of these is available
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+#define SIMD_INT __m256i
+#define SIMD_SET1 _mm256_set1_epi32
+#define SIMD_LOAD(p) _mm256_loadu_si256((const __m256i*)(p))
+#define SIMD_STORE(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+#define SIMD_ADD _mm256_add_epi32
+#define SIMD_AND _mm256_and_si256
+#define SIMD_GREATER _mm256_cmpgt_epi32
+#define SIMD_ALL(v) (_mm256_movemask_epi8(v) == -1)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+#define SIMD_INT __m128i
+#define SIMD_SET1 _mm_set1_epi32
+#define SIMD_LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define SIMD_STORE(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define SIMD_ADD _mm_add_epi32
+#define SIMD_AND _mm_and_si128
+#define SIMD_GREATER _mm_cmpgt_epi32
+#define SIMD_ALL(v) (_mm_movemask_epi8(v) == 0xFFFF)
+#endif
 
+//*****************************************************************************
+// ********************************** RANDOM **********************************
+//*****************************************************************************
+uint32_t counterRandom::draw(uint64_t pSeed, uint64_t pStream, uint64_t pCounter)
+{
+    //Two rounds of the splitmix64 finalizer over the key
+    uint64_t z = pSeed + 0x9E3779B97F4A7C15ull * (pStream + 1);
+    for (int vRound = 0; vRound < 2; vRound++)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z = z ^ (z >> 31);
+        z += 0x9E3779B97F4A7C15ull * (pCounter + 1);
+    }
+    return (uint32_t)(z >> 32);
+}
+//*****************************************************************************
+// ******************************* SPRITE ATLAS *******************************
+//*****************************************************************************
+spriteAtlas::spriteAtlas()
+{
+    this->sheet_ = NULL;
+    this->texture_ = NULL;
+}
+/////////////////////////////////////////////
+void spriteAtlas::load(const std::vector<std::vector<std::string>>& pAnimations, threadPool& pPool)
+{
+    //Every image is decoded and converted to ARGB8888 on the pool
+    std::vector<std::string> vPaths;
+    for (const std::vector<std::string>& vAnimation : pAnimations)
+        vPaths.insert(vPaths.end(), vAnimation.begin(), vAnimation.end());
+    std::vector<SDL_Surface*> vImages(vPaths.size(), NULL);
+    pPool.run((int)vPaths.size(), 1, [&](int pBegin, int pEnd, int, int) {
+        for (int vI = pBegin; vI < pEnd; vI++)
+        {
+            SDL_Surface* vImage = IMG_Load(vPaths[vI].c_str());
+            if (vImage == NULL)
+                continue;
+            vImages[vI] = SDL_ConvertSurfaceFormat(vImage, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(vImage);
+        }
+    });
+    for (int vI = 0; vI < (int)vImages.size(); vI++)
+        if (vImages[vI] == NULL)
+        {
+            for (SDL_Surface* vImage : vImages)
+                SDL_FreeSurface(vImage);
+            throw std::runtime_error("IMG_Load error : " + vPaths[vI]);
+        }
+
+    //Each animation on its own row
+    int vWidth = 0;
+    int vHeight = 0;
+    int vFrame = 0;
+    for (const std::vector<std::string>& vAnimation : pAnimations)
+    {
+        this->animationStarts_.push_back((int)this->frames_.size());
+        int vX = 0;
+        int vRowHeight = 0;
+        for (int vI = 0; vI < (int)vAnimation.size(); vI++, vFrame++)
+        {
+            this->frames_.push_back({ vX, vHeight, vImages[vFrame]->w, vImages[vFrame]->h });
+            vX += vImages[vFrame]->w;
+            vRowHeight = std::max(vRowHeight, vImages[vFrame]->h);
+        }
+        vWidth = std::max(vWidth, vX);
+        vHeight += vRowHeight;
+    }
+    //Frames do not overlap in the sheet, they are copied in parallel too, transparent pixels stay transparent
+    this->sheet_ = SDL_CreateRGBSurfaceWithFormat(0, vWidth, vHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (this->sheet_ == NULL)
+        throw std::runtime_error("SDL_CreateRGBSurfaceWithFormat error");
+    pPool.run((int)vImages.size(), 4, [&](int pBegin, int pEnd, int, int) {
+        for (int vI = pBegin; vI < pEnd; vI++)
+        {
+            const SDL_Rect& vRect = this->frames_[vI];
+            for (int vY = 0; vY < vRect.h; vY++)
+                memcpy((char*)this->sheet_->pixels + (vRect.y + vY) * this->sheet_->pitch + vRect.x * 4,
+                    (const char*)vImages[vI]->pixels + vY * vImages[vI]->pitch, vRect.w * 4);
+        }
+    });
+    for (SDL_Surface* vImage : vImages)
+        SDL_FreeSurface(vImage);
+    SDL_SetSurfaceBlendMode(this->sheet_, SDL_BLENDMODE_BLEND);
+}
+/////////////////////////////////////////////
+void spriteAtlas::optimize(const SDL_PixelFormat* pFormat)
+{
+    //Converted once to the layout of the window, so no blit converts pixels. Sprites with only
+    //opaque and transparent pixels get a colour key, the others keep their alpha channel,
+    //both are run-length encoded so the transparent runs are skipped
+    uint32_t* vPixels = (uint32_t*)this->sheet_->pixels;
+    int vCount = this->sheet_->w * this->sheet_->h;//ARGB8888 rows have no padding
+    bool vBinary = true;
+    for (int vP = 0; vP < vCount && vBinary; vP++)
+        vBinary = (vPixels[vP] >> 24 == 0 || vPixels[vP] >> 24 == 255);
+    SDL_Surface* vOptimized = NULL;
+    if (vBinary)
+    {
+        //The key is a colour no opaque pixel has, once in the window format
+        static const uint32_t Keys[] = { 0xFF00FF, 0x00FF00, 0x00FFFF, 0xFE01FD };
+        for (uint32_t vKey : Keys)
+        {
+            uint32_t vMapped = SDL_MapRGB(pFormat, (vKey >> 16) & 0xFF, (vKey >> 8) & 0xFF, vKey & 0xFF);
+            bool vUsed = false;
+            for (int vP = 0; vP < vCount && !vUsed; vP++)
+                vUsed = (vPixels[vP] >> 24 != 0 && SDL_MapRGB(pFormat, (vPixels[vP] >> 16) & 0xFF, (vPixels[vP] >> 8) & 0xFF, vPixels[vP] & 0xFF) == vMapped);
+            if (vUsed)
+                continue;
+            for (int vP = 0; vP < vCount; vP++)
+                if (vPixels[vP] >> 24 == 0)
+                    vPixels[vP] = vKey;
+            vOptimized = SDL_ConvertSurface(this->sheet_, pFormat, 0);
+            if (vOptimized != NULL)
+                SDL_SetColorKey(vOptimized, SDL_TRUE, vMapped);
+            break;
+        }
+    }
+    if (vOptimized == NULL)
+    {
+        //Window layout, the alpha channel in the bits it leaves free
+        uint32_t vFormat = SDL_PIXELFORMAT_ARGB8888;
+        if (pFormat->BitsPerPixel == 32 && pFormat->Amask == 0)
+        {
+            uint32_t vAlpha = ~(pFormat->Rmask | pFormat->Gmask | pFormat->Bmask);
+            uint32_t vMatching = SDL_MasksToPixelFormatEnum(32, pFormat->Rmask, pFormat->Gmask, pFormat->Bmask, vAlpha);
+            if (vMatching != SDL_PIXELFORMAT_UNKNOWN)
+                vFormat = vMatching;
+        }
+        vOptimized = SDL_ConvertSurfaceFormat(this->sheet_, vFormat, 0);
+        if (vOptimized != NULL)
+            SDL_SetSurfaceBlendMode(vOptimized, SDL_BLENDMODE_BLEND);
+    }
+    if (vOptimized == NULL)
+        throw std::runtime_error("SDL_ConvertSurface error");
+    SDL_SetSurfaceRLE(vOptimized, 1);
+    SDL_FreeSurface(this->sheet_);
+    this->sheet_ = vOptimized;
+}
+/////////////////////////////////////////////
+void spriteAtlas::upload(SDL_Renderer* pRenderer)
+{
+    //Once, every frame is then drawn from the same texture
+    this->texture_ = SDL_CreateTextureFromSurface(pRenderer, this->sheet_);
+    if (this->texture_ == NULL)
+        throw std::runtime_error("SDL_CreateTextureFromSurface error");
+    SDL_SetTextureBlendMode(this->texture_, SDL_BLENDMODE_BLEND);
+}
+//*****************************************************************************
+// *********************************** HERD ***********************************
+//*****************************************************************************
+herd::herd(species pSpecies, int width, int height, int totalVelocity, int frameInterval, int frameCount)
+{
+    this->species_ = pSpecies;
+    this->width_ = width;
+    this->height_ = height;
+    this->totalVelocity_ = totalVelocity;
+    this->frameInterval_ = frameInterval;
+    this->frameCount_ = frameCount;
+    this->seed_ = 0;
+    this->nextSerial_ = 0;
+    this->worldWidth_ = frame_width;
+    this->worldHeight_ = frame_height;
+    this->now_ = 0;
+    this->wheel_ = NULL;
+}
+/////////////////////////////////////////////
+int herd::add(int x, int y)
+{
+    this->x_.push_back(x);
+    this->y_.push_back(y);
+    this->prevX_.push_back(x);
+    this->prevY_.push_back(y);
+    this->xVelocity_.push_back(0);
+    this->yVelocity_.push_back(0);
+    this->properties_.push_back(0);
+    this->fieldsSet_.push_back(0);
+    for (std::vector<int>& vField : this->fields_)
+        vField.push_back(0);
+    this->frameDuration_.push_back(this->frameInterval_);
+    this->frameIndex_.push_back(0);
+    this->direction_.push_back(-1);
+    this->serial_.push_back(this->nextSerial_++);
+    this->draws_.push_back(0);
+    int vIndex = this->size() - 1;
+    this->setRandomVelocitys(vIndex);
+    return vIndex;
+}
+/////////////////////////////////////////////
+void herd::resize(int pSize)
+{
+    this->x_.resize(pSize);
+    this->y_.resize(pSize);
+    this->prevX_.resize(pSize);
+    this->prevY_.resize(pSize);
+    this->xVelocity_.resize(pSize);
+    this->yVelocity_.resize(pSize);
+    this->properties_.resize(pSize);
+    this->fieldsSet_.resize(pSize);
+    for (std::vector<int>& vField : this->fields_)
+        vField.resize(pSize);
+    this->frameDuration_.resize(pSize);
+    this->frameIndex_.resize(pSize);
+    this->direction_.resize(pSize);
+    this->serial_.resize(pSize);
+    this->draws_.resize(pSize);
+}
+/////////////////////////////////////////////
+void herd::reserve(int pCapacity)
+{
+    this->x_.reserve(pCapacity);
+    this->y_.reserve(pCapacity);
+    this->prevX_.reserve(pCapacity);
+    this->prevY_.reserve(pCapacity);
+    this->xVelocity_.reserve(pCapacity);
+    this->yVelocity_.reserve(pCapacity);
+    this->properties_.reserve(pCapacity);
+    this->fieldsSet_.reserve(pCapacity);
+    for (std::vector<int>& vField : this->fields_)
+        vField.reserve(pCapacity);
+    this->frameDuration_.reserve(pCapacity);
+    this->frameIndex_.reserve(pCapacity);
+    this->direction_.reserve(pCapacity);
+    this->serial_.reserve(pCapacity);
+    this->draws_.reserve(pCapacity);
+}
+/////////////////////////////////////////////
+int herd::removeIf(propertie pPropertie)
+{
+    //Nothing moves before the first one removed
+    int vSize = this->size();
+    int vFirst = 0;
+    while (vFirst < vSize && !this->hasPropertie(vFirst, pPropertie))
+        vFirst++;
+    if (vFirst == vSize)
+        return 0;
+    //Compaction one column at a time, each is read once in order. The order of the remaining agents is kept
+    int vKept = vFirst;
+    for (int vI = vFirst; vI < vSize; vI++)
+        if (!this->hasPropertie(vI, pPropertie))
+        {
+            if (this->wheel_ != NULL && vKept != vI)
+                this->wheel_->move(vI, vKept);
+            vKept++;
+        }
+        else
+        {
+            if (this->wheel_ != NULL)
+                this->wheel_->remove(vI);
+            if (!this->extras_.empty())
+                this->extras_.erase(this->serial_[vI]);
+        }
+    uint32_t vMask = 1u << (int)pPropertie;
+    const std::vector<uint32_t>& vProperties = this->properties_;
+    auto vCompact = [&](auto& pColumn) {
+        int vTo = vFirst;
+        for (int vI = vFirst; vI < vSize; vI++)
+            if (!(vProperties[vI] & vMask))
+                pColumn[vTo++] = std::move(pColumn[vI]);
+    };
+    //The properties tell which agents stay, they go last
+    this->forEachColumn([&](auto& pColumn) {
+        if ((const void*)&pColumn != (const void*)&vProperties)
+            vCompact(pColumn);
+    });
+    vCompact(this->properties_);
+    this->resize(vKept);
+    return vSize - vKept;
+}
+/////////////////////////////////////////////
+bool herd::removePropertie(int pIndex, propertie pPropertie)
+{
+    bool vHad = this->hasPropertie(pIndex, pPropertie);
+    this->properties_[pIndex] &= ~(1u << (int)pPropertie);
+    return vHad;
+}
+/////////////////////////////////////////////
+void herd::setValue(int pIndex, field pField, int pValue)
+{
+    this->fields_[(int)pField][pIndex] = pValue;
+    this->fieldsSet_[pIndex] |= 1u << (int)pField;
+}
+/////////////////////////////////////////////
+void herd::savePositions()
+{
+    std::copy(this->x_.begin(), this->x_.end(), this->prevX_.begin());
+    std::copy(this->y_.begin(), this->y_.end(), this->prevY_.begin());
+}
+/////////////////////////////////////////////
+uint32_t herd::random(int pIndex)
+{
+    return counterRandom::draw(this->seed_, ((uint64_t)this->species_ << 32) | this->serial_[pIndex], this->draws_[pIndex]++);
+}
+/////////////////////////////////////////////
+extraRecord* herd::findExtras(int pIndex)
+{
+    if (this->extras_.empty())
+        return NULL;
+    std::map<uint32_t, extraRecord>::iterator it = this->extras_.find(this->serial_[pIndex]);
+    return (it != this->extras_.end() ? &it->second : NULL);
+}
+/////////////////////////////////////////////
+int herd::getDistance(int pIndex, herd& pHerd2, int pIndex2)
+{
+    int xDistance = std::min(abs(this->getXBox(pIndex) - pHerd2.getXBox(pIndex2)), abs(this->getXBox(pIndex) - pHerd2.getXBox(pIndex2) - pHerd2.getWidthBox()));
+    int yDistance = std::min(abs(this->getYBox(pIndex) - pHerd2.getYBox(pIndex2)), abs(this->getYBox(pIndex) - pHerd2.getYBox(pIndex2) - pHerd2.getHeightBox()));
+    return (int)std::sqrt(xDistance * xDistance + yDistance * yDistance);
+}
+/////////////////////////////////////////////
+bool herd::overlap(int pIndex, herd& pHerd2, int pIndex2)
+{
+    return!((this->getXBox(pIndex) > pHerd2.getXBox(pIndex2) + pHerd2.getWidthBox())
+        || (this->getXBox(pIndex) + this->getWidthBox() < pHerd2.getXBox(pIndex2))
+        || (this->getYBox(pIndex) > pHerd2.getYBox(pIndex2) + pHerd2.getHeightBox())
+        || (this->getYBox(pIndex) + this->getHeightBox() < pHerd2.getYBox(pIndex2)));
+}
+/////////////////////////////////////////////
+bool herd::canMoveX(int pIndex) { return (this->getXBox(pIndex) + this->xVelocity_[pIndex] + this->getWidthBox() < this->worldWidth_) && (this->getXBox(pIndex) + this->xVelocity_[pIndex] > 0); }
+bool herd::canMoveY(int pIndex) { return (this->getYBox(pIndex) + this->yVelocity_[pIndex] + this->getHeightBox() < this->worldHeight_) && (this->getYBox(pIndex) + this->yVelocity_[pIndex] > 0); }
+/////////////////////////////////////////////
+void herd::goToward(int pIndex, herd& pHerd2, int pIndex2) { this->goToward(pIndex, pHerd2.getXBox(pIndex2), pHerd2.getYBox(pIndex2)); }
+void herd::goToward(int pIndex, int x, int y)
+{
+    this->xVelocity_[pIndex] = x - this->getXBox(pIndex);
+    this->yVelocity_[pIndex] = y - this->getYBox(pIndex);
+    this->adjustVelocitys(pIndex);
+}
+/////////////////////////////////////////////
+bool herd::drawsToward(int pIndex, int x, int y)
+{
+    //adjustVelocitys without the writes, the speed is only short when a border cut it
+    int vXVelocity = herd::clampVelocity(x - this->getXBox(pIndex), 1 - this->getXBox(pIndex), this->worldWidth_ - this->getWidthBox() - this->getXBox(pIndex) - 1);
+    int vYVelocity = herd::clampVelocity(y - this->getYBox(pIndex), 1 - this->getYBox(pIndex), this->worldHeight_ - this->getHeightBox() - this->getYBox(pIndex) - 1);
+    herd::limitSpeed(vXVelocity, vYVelocity, abs(this->totalVelocity_));
+    return abs(vXVelocity) + abs(vYVelocity) < abs(this->totalVelocity_);
+}
+/////////////////////////////////////////////
+void herd::getDrawingBox(int pIndex, int& pLeft, int& pTop, int& pRight, int& pBottom)
+{
+    //A target closer than the speed on an axis, or on the side of a border too close to go at full speed, up to the end of the world
+    int vTotal = abs(this->totalVelocity_);
+    auto vRange = [vTotal](int pMin, int pMax, int pWorld, int& pLow, int& pHigh) {
+        pLow = (pMin > -vTotal || pMax < -1 ? -pWorld : 1 - vTotal);
+        pHigh = (pMax < vTotal || pMin > 1 ? pWorld : vTotal - 1);
+    };
+    int vX = this->getXBox(pIndex);
+    int vY = this->getYBox(pIndex);
+    vRange(1 - vX, this->worldWidth_ - this->getWidthBox() - vX - 1, this->worldWidth_, pLeft, pRight);
+    vRange(1 - vY, this->worldHeight_ - this->getHeightBox() - vY - 1, this->worldHeight_, pTop, pBottom);
+    pLeft += vX;
+    pRight += vX;
+    pTop += vY;
+    pBottom += vY;
+}
+/////////////////////////////////////////////
+void herd::runAway(int pIndex, herd& pHerd2, int pIndex2) { this->runAway(pIndex, pHerd2.getXBox(pIndex2), pHerd2.getYBox(pIndex2)); }
+void herd::runAway(int pIndex, int x, int y)
+{
+    this->xVelocity_[pIndex] = this->getXBox(pIndex) - x;
+    this->yVelocity_[pIndex] = this->getYBox(pIndex) - y;
+    this->adjustVelocitys(pIndex);
+}
+/////////////////////////////////////////////
+void herd::setRandomVelocitys(int pIndex)
+{
+    int& xVelocity = this->xVelocity_[pIndex];
+    int& yVelocity = this->yVelocity_[pIndex];
+    xVelocity = ((int)(this->random(pIndex) % this->totalVelocity_) * 2) - this->totalVelocity_;
+    if (!canMoveX(pIndex))
+        xVelocity = -xVelocity;
+    yVelocity = ((((int)(this->random(pIndex) % 2)) * 2) - 1) * (this->totalVelocity_ - abs(xVelocity));
+    if (!canMoveY(pIndex))
+        yVelocity = -yVelocity;
+}
+/////////////////////////////////////////////
+void herd::adjustVelocitys(int pIndex)
+{
+    int& xVelocity = this->xVelocity_[pIndex];
+    int& yVelocity = this->yVelocity_[pIndex];
+    //Hors map
+    xVelocity = herd::clampVelocity(xVelocity, 1 - this->getXBox(pIndex), this->worldWidth_ - this->getWidthBox() - this->getXBox(pIndex) - 1);
+    yVelocity = herd::clampVelocity(yVelocity, 1 - this->getYBox(pIndex), this->worldHeight_ - this->getHeightBox() - this->getYBox(pIndex) - 1);
+    //Vitesse trop lev
+    herd::limitSpeed(xVelocity, yVelocity, abs(this->totalVelocity_));
+    //Vitesse trop faible
+    if (abs(xVelocity) + abs(yVelocity) < abs(this->totalVelocity_))
+        this->setRandomVelocitys(pIndex);
+}
+/////////////////////////////////////////////
+int herd::clampVelocity(int pVelocity, int pMin, int pMax)
+{
+    //Was slowed down one unit at a time until it fits in [pMin, pMax] or stops
+    if (pVelocity > 0)
+    {
+        int vVelocity = std::min(pVelocity, pMax);
+        return (vVelocity >= std::max(pMin, 1) ? vVelocity : 0);
+    }
+    if (pVelocity < 0)
+    {
+        int vVelocity = std::max(pVelocity, pMin);
+        return (vVelocity <= std::min(pMax, -1) ? vVelocity : 0);
+    }
+    return 0;
+}
+/////////////////////////////////////////////
+void herd::limitSpeed(int& pXVelocity, int& pYVelocity, int pTotal)
+{
+    //Was one unit off x then one off y until |x| + |y| <= pTotal. A velocity at 0
+    //goes to 1 on its next step and back to 0 on the following one. vStep counts
+    //the single steps taken, x on odd ones and y on even ones
+    int vA = abs(pXVelocity);
+    int vB = abs(pYVelocity);
+    int vExcess = vA + vB - pTotal;
+    if (vExcess <= 0)
+        return;
+    int vStep;
+    if (vExcess <= std::min(2 * vA, 2 * vB + 1))
+        vStep = vExcess;//Both still slowing down
+    else if (vA <= vB)
+    {
+        //x reached 0 first, over 4 steps the excess goes d+1, d, d-1, d-2
+        int vD = vB - vA;
+        int vQ = std::max(0, (vD - pTotal - 1) / 2);
+        int vK = std::max(1, vD - 2 * vQ + 2 - pTotal);
+        vStep = 2 * vA + 4 * vQ + vK;
+    }
+    else
+    {
+        //y reached 0 first, over 4 steps the excess goes d, d-1, d-2, d-3
+        int vD = vA - vB;
+        int vQ = std::max(0, (vD - pTotal - 2) / 2);
+        int vK = std::max(1, vD - 2 * vQ + 1 - pTotal);
+        vStep = 2 * vB + 1 + 4 * vQ + vK;
+    }
+    int vI = (vStep + 1) / 2;
+    int vJ = vStep / 2;
+    pXVelocity = (vI <= vA ? (pXVelocity > 0 ? vA - vI : vI - vA) : (vI - vA) & 1);
+    pYVelocity = (vJ <= vB ? (pYVelocity > 0 ? vB - vJ : vJ - vB) : (vJ - vB) & 1);
+}
+/////////////////////////////////////////////
+void herd::move(int pIndex)
+{
+    if (!canMoveX(pIndex) || !canMoveY(pIndex))
+        this->setRandomVelocitys(pIndex);
+    this->x_[pIndex] += this->xVelocity_[pIndex];
+    this->y_[pIndex] += this->yVelocity_[pIndex];
+}
+/////////////////////////////////////////////
+void herd::moveRange(int pBegin, int pEnd)
+{
+    //The new corner of the box must stay strictly inside the map
+    int vLowX = -(this->width_ - this->getWidthBox()) / 2;
+    int vHighX = this->worldWidth_ - this->getWidthBox() - (this->width_ - this->getWidthBox()) / 2;
+    int vLowY = -(this->height_ - this->getHeightBox()) / 2;
+    int vHighY = this->worldHeight_ - this->getHeightBox() - (this->height_ - this->getHeightBox()) / 2;
+    int vI = pBegin;
+#if defined(SIMD_WIDTH)
+    //A block where every agent can move is moved at once, else agent by agent.
+    //Only the move is batched : the velocities are clamped and normalised in adjustVelocitys, one agent at a time,
+    //when an encounter changes them, and setRandomVelocitys draws from each agent's own stream
+    SIMD_INT vLowXs = SIMD_SET1(vLowX), vHighXs = SIMD_SET1(vHighX), vLowYs = SIMD_SET1(vLowY), vHighYs = SIMD_SET1(vHighY);
+    for (; vI + SIMD_WIDTH <= pEnd; vI += SIMD_WIDTH)
+    {
+        SIMD_INT vX = SIMD_ADD(SIMD_LOAD(&this->x_[vI]), SIMD_LOAD(&this->xVelocity_[vI]));
+        SIMD_INT vY = SIMD_ADD(SIMD_LOAD(&this->y_[vI]), SIMD_LOAD(&this->yVelocity_[vI]));
+        SIMD_INT vInside = SIMD_AND(SIMD_AND(SIMD_GREATER(vX, vLowXs), SIMD_GREATER(vHighXs, vX)),
+            SIMD_AND(SIMD_GREATER(vY, vLowYs), SIMD_GREATER(vHighYs, vY)));
+        if (SIMD_ALL(vInside))
+        {
+            SIMD_STORE(&this->x_[vI], vX);
+            SIMD_STORE(&this->y_[vI], vY);
+        }
+        else
+            for (int vJ = vI; vJ < vI + SIMD_WIDTH; vJ++)
+                this->move(vJ);
+    }
+#endif
+    for (; vI < pEnd; vI++)
+        this->move(vI);
+}
+/////////////////////////////////////////////
+direction herd::getDirection(int pIndex)
+{
+    int xVelocity = this->xVelocity_[pIndex];
+    int yVelocity = this->yVelocity_[pIndex];
+    if (xVelocity <= 0 && yVelocity >= 0) { return direction::sw; }
+    if (xVelocity >= 0 && yVelocity >= 0) { return direction::se; }
+    if (xVelocity <= 0 && yVelocity <= 0) { return direction::nw; }
+    return direction::ne;
+}
+/////////////////////////////////////////////
+void herd::updateFrameDuration(int pIndex)
+{
+    this->frameDuration_[pIndex]++;
+    if (this->frameDuration_[pIndex] >= this->frameInterval_)
+        this->nextFrame(pIndex);
+}
+/////////////////////////////////////////////
+void herd::nextFrame(int pIndex)
+{
+    this->frameIndex_[pIndex]++;
+    this->direction_[pIndex] = (int)this->getDirection(pIndex);
+    if (this->frameIndex_[pIndex] >= this->frameCount_)
+        this->frameIndex_[pIndex] = 0;
+    this->frameDuration_[pIndex] = 0;
+}
 //*****************************************************************************
 // ********************************* OBJECT ***********************************
 //*****************************************************************************
 object::object()
+{
+    this->herd_ = NULL;
+    this->index_ = 0;
+}
+/////////////////////////////////////////////
+object::object(herd* pHerd, int pIndex)
+{
+    this->herd_ = pHerd;
+    this->index_ = pIndex;
+}
+/////////////////////////////////////////////
+bool object::findPropertie(const std::string& pName, propertie& pPropertie)
+{
+    static const std::map<std::string, propertie> Names = {
+        {"shepherd", propertie::shepherd}, {"wolf", propertie::wolf}, {"sheep", propertie::sheep},
+        {"prey", propertie::prey}, {"canprocreate", propertie::canprocreate}, {"male", propertie::male},
+        {"female", propertie::female}, {"dead", propertie::dead}, {"pregnant", propertie::pregnant},
+        {"scared", propertie::scared} };
+    std::map<std::string, propertie>::const_iterator it = Names.find(pName);
+    if (it == Names.end())
+        return false;
+    pPropertie = it->second;
+    return true;
+}
+/////////////////////////////////////////////
+bool object::findField(const std::string& pName, field& pField)
+{
+    static const std::map<std::string, field> Names = {
+        {"preyDistance", field::preyDistance}, {"starveTick", field::starveTick},
+        {"procreateTick", field::procreateTick} };
+    std::map<std::string, field>::const_iterator it = Names.find(pName);
+    if (it == Names.end())
+        return false;
+    pField = it->second;
+    return true;
+}
+/////////////////////////////////////////////
+bool object::findCountdown(const std::string& pName, field& pField, int& pShift)
+{
+    //A wolf died on the tick its countdown reached 0 once decremented, a sheep could mate again once it was at 0
+    if (pName == "timeBeforeStarve")
+    {
+        pField = field::starveTick;
+        pShift = -1;
+        return true;
+    }
+    if (pName == "timeBeforeProcreate")
+    {
+        pField = field::procreateTick;
+        pShift = 0;
+        return true;
+    }
+    return false;
+}
+/////////////////////////////////////////////
+bool object::hasValue(const std::string& pKey)
+{
+    field vField;
+    int vShift;
+    if (findField(pKey, vField) || findCountdown(pKey, vField, vShift))
+        return this->hasValue(vField);
+    extraRecord* vExtras = this->herd_->findExtras(this->index_);
+    return vExtras != NULL && vExtras->values_.count(pKey);
+}
+/////////////////////////////////////////////
+int object::getValue(const std::string& pKey)
+{
+    field vField;
+    int vShift;
+    if (findField(pKey, vField))
+        return this->getValue(vField);
+    if (findCountdown(pKey, vField, vShift))
+        return this->getValue(vField) - this->herd_->now_ - vShift;
+    //0 when never set, as the slow path map gave before
+    extraRecord* vExtras = this->herd_->findExtras(this->index_);
+    if (vExtras == NULL)
+        return 0;
+    std::map<std::string, int>::iterator it = vExtras->values_.find(pKey);
+    return (it != vExtras->values_.end() ? it->second : 0);
+}
+/////////////////////////////////////////////
+void object::setValue(const std::string& pKey, int pValue)
+{
+    field vField;
+    int vShift;
+    if (findCountdown(pKey, vField, vShift))
+        pValue += this->herd_->now_ + vShift;
+    else if (!findField(pKey, vField))
+    {
+        this->herd_->extras_[this->herd_->serial_[this->index_]].values_[pKey] = pValue;
+        return;
+    }
+    //The timing wheel only catches up with the deadlines that moved later
+    if (vField == field::starveTick && this->herd_->wheel_ != NULL && pValue < this->getValue(vField))
+    {
+        this->herd_->wheel_->remove(this->index_);
+        this->herd_->wheel_->schedule(std::max(pValue, this->herd_->now_), this->index_);
+    }
+    this->setValue(vField, pValue);
+}
+/////////////////////////////////////////////
+void object::addPropertie(const std::string& pPropertie)
+{
+    propertie vPropertie;
+    if (findPropertie(pPropertie, vPropertie))
+        this->addPropertie(vPropertie);
+    else
+        this->herd_->extras_[this->herd_->serial_[this->index_]].properties_.push_back(pPropertie);
+}
+/////////////////////////////////////////////
+bool object::hasPropertie(const std::string& pPropertie)
+{
+    propertie vPropertie;
+    if (findPropertie(pPropertie, vPropertie))
+        return this->hasPropertie(vPropertie);
+    extraRecord* vExtras = this->herd_->findExtras(this->index_);
+    return vExtras != NULL && std::find(vExtras->properties_.begin(), vExtras->properties_.end(), pPropertie) != vExtras->properties_.end();
+}
+/////////////////////////////////////////////
+bool object::removePropertie(const std::string& pPropertie)
+{
+    propertie vPropertie;
+    if (findPropertie(pPropertie, vPropertie))
+        return this->removePropertie(vPropertie);
+    extraRecord* vExtras = this->herd_->findExtras(this->index_);
+    if (vExtras == NULL)
+        return false;
+    std::vector<std::string>::iterator itr = std::find(vExtras->properties_.begin(), vExtras->properties_.end(), pPropertie);
+    if (itr == vExtras->properties_.end())
+        return false;
+    vExtras->properties_.erase(itr);
+    if (vExtras->properties_.empty() && vExtras->values_.empty())
+        this->herd_->extras_.erase(this->herd_->serial_[this->index_]);
+    return true;
+}
+//*****************************************************************************
+// ***************************** RENDERED OBJECT ******************************
+//*****************************************************************************
+renderedObject::renderedObject(herd* pHerd, int pIndex) :
+    object(pHerd, pIndex)
+{}
+int renderedObject::getHeightBox() { return this->herd_->getHeightBox(); }
+int renderedObject::getWidthBox() { return this->herd_->getWidthBox(); }
+int renderedObject::getXBox() { return this->herd_->getXBox(this->index_); }
+int renderedObject::getYBox() { return this->herd_->getYBox(this->index_); }
+int renderedObject::getX() { return this->herd_->x_[this->index_]; }
+int renderedObject::getY() { return this->herd_->y_[this->index_]; }
+/////////////////////////////////////////////
+int renderedObject::getDistance(renderedObject* pO2) { return this->herd_->getDistance(this->index_, *pO2->getHerd(), pO2->getIndex()); }
+bool renderedObject::overlap(renderedObject* pO2) { return this->herd_->overlap(this->index_, *pO2->getHerd(), pO2->getIndex()); }
+//*****************************************************************************
+// ****************************** MOVING OBJECT *******************************
+//*****************************************************************************
+int movingObject::getXVelocity() { return this->herd_->xVelocity_[this->index_]; }
+int movingObject::getYVelocity() { return this->herd_->yVelocity_[this->index_]; }
+bool movingObject::canMoveX() { return this->herd_->canMoveX(this->index_); }
+bool movingObject::canMoveY() { return this->herd_->canMoveY(this->index_); }
+/////////////////////////////////////////////
+void movingObject::goToward(renderedObject* vMO) { this->herd_->goToward(this->index_, *vMO->getHerd(), vMO->getIndex()); }
+void movingObject::goToward(int x, int y) { this->herd_->goToward(this->index_, x, y); }
+void movingObject::runAway(renderedObject* vMO) { this->herd_->runAway(this->index_, *vMO->getHerd(), vMO->getIndex()); }
+void movingObject::runAway(int x, int y) { this->herd_->runAway(this->index_, x, y); }
+/////////////////////////////////////////////
+void movingObject::setRandomVelocitys() { this->herd_->setRandomVelocitys(this->index_); }
+void movingObject::adjustVelocitys() { this->herd_->adjustVelocitys(this->index_); }
+void movingObject::move() { this->herd_->move(this->index_); }
+/////////////////////////////////////////////
+void movingObject::interact(renderedObject* pO2)
+{
+    if (meet(*this->herd_, this->index_, *pO2->getHerd(), pO2->getIndex()))
+        pO2->addPropertie(propertie::dead);
+}
+//*****************************************************************************
+// ***************************** ANIMATED OBJECT ******************************
+//*****************************************************************************
+int animatedObject::getFrameIndex() { return this->herd_->frameIndex_[this->index_]; }
+void animatedObject::updateFrameDuration() { this->herd_->updateFrameDuration(this->index_); }
+void animatedObject::nextFrame() { this->herd_->nextFrame(this->index_); }
+/////////////////////////////////////////////
+std::vector<std::vector<std::string>> animatedObject::createPathMap(std::string pFolder, int pFrameCount)
+{
+    static const std::string Directions[] = { "nw", "ne", "sw", "se" };
+    std::vector<std::vector<std::string>> vPathMap;
+    for (const std::string& vDirection : Directions)
+    {
+        vPathMap.emplace_back();
+        for (int i = 1; i <= pFrameCount; i++)
+            vPathMap.back().push_back(pFolder + vDirection + " (" + std::to_string(i) + ").png");
+    }
+    return vPathMap;
+}
+//*****************************************************************************
+// ********************************* SHEPERD **********************************
+//*****************************************************************************
+spriteAtlas shepherd::Atlas;
+//*****************************************************************************
+shepherd::shepherd(herd* pHerd, int pIndex) :
+    renderedObject(pHerd, pIndex)
+{}
+/////////////////////////////////////////////
+herd shepherd::createHerd() { return herd(species::shepherd, traits::Width, traits::Height, traits::Velocity, traits::FrameInterval, traits::FrameCount); }
+/////////////////////////////////////////////
+int shepherd::add(herd& pShepherds)
+{
+    int vIndex = pShepherds.add(pShepherds.worldWidth_ / 2, pShepherds.worldHeight_ / 2);
+    pShepherds.addPropertie(vIndex, propertie::shepherd);
+    return vIndex;
+}
+/////////////////////////////////////////////
+std::vector<std::vector<std::string>> shepherd::getImagePaths() { return { { "media/shepherd.png" } }; }
+/////////////////////////////////////////////
+const SDL_Rect& shepherd::getFrame(herd&, int) { return Atlas.getFrame(0, 0); }
+/////////////////////////////////////////////
+void shepherd::update()
+{
+    shepherd::move(*this->herd_, this->index_, SDL_GetKeyboardState(0));
+}
+/////////////////////////////////////////////
+void shepherd::move(herd& pShepherds, int pIndex, const uint8_t* keystate)
+{
+    //No keyboard without a window : the shepherd stays still in headless runs
+    if (keystate == NULL)
+        return;
+    int& xVelocity = pShepherds.xVelocity_[pIndex];
+    int& yVelocity = pShepherds.yVelocity_[pIndex];
+    //Horizontal Velocity
+    if (keystate[SDL_SCANCODE_LEFT])
+        xVelocity = -pShepherds.totalVelocity_;
+    else if (keystate[SDL_SCANCODE_RIGHT])
+        xVelocity = pShepherds.totalVelocity_;
+    else
+        xVelocity = 0;
+    //Vertical Velocity
+    if (keystate[SDL_SCANCODE_UP])
+        yVelocity = -pShepherds.totalVelocity_;
+    else if (keystate[SDL_SCANCODE_DOWN])
+        yVelocity = pShepherds.totalVelocity_;
+    else
+        yVelocity = 0;
+    //Move
+    if (pShepherds.canMoveX(pIndex))
+        pShepherds.x_[pIndex] += xVelocity;
+    if (pShepherds.canMoveY(pIndex))
+        pShepherds.y_[pIndex] += yVelocity;
+}
+//*****************************************************************************
+//*********************************** WOLF ************************************
+//*****************************************************************************
+spriteAtlas wolf::Atlas;
+//*****************************************************************************
+wolf::wolf(herd* pHerd, int pIndex) :
+    renderedObject(pHerd, pIndex)
 {}
 /////////////////////////////////////////////
-bool object::hasValue(std::string pKey)
+herd wolf::createHerd() { return herd(species::wolf, traits::Width, traits::Height, traits::Velocity, traits::FrameInterval, traits::FrameCount); }
+/////////////////////////////////////////////
+int wolf::add(herd& pWolfs, int x, int y)
+{
+    int vIndex = pWolfs.add(x, y);
+    pWolfs.setValue(vIndex, field::preyDistance, -1);
+    pWolfs.setValue(vIndex, field::starveTick, pWolfs.now_ + traits::StarveDelay - 1);
+    pWolfs.addPropertie(vIndex, propertie::wolf);
+    return vIndex;
+}
+/////////////////////////////////////////////
+int wolf::add(herd& pWolfs)
+{
+    //Placed with its own stream once it exists
+    int vIndex = wolf::add(pWolfs, 0, 0);
+    pWolfs.x_[vIndex] = pWolfs.random(vIndex) % (pWolfs.worldWidth_ - traits::Width);
+    pWolfs.y_[vIndex] = pWolfs.random(vIndex) % (pWolfs.worldHeight_ - traits::Height);
+    return vIndex;
+}
+/////////////////////////////////////////////
+std::vector<std::vector<std::string>> wolf::getImagePaths()
+{
+    std::vector<std::vector<std::string>> vPathMap = createPathMap("media/wolfs/", 12);
+    vPathMap.push_back({ "media/wolf.png" });
+    return vPathMap;
+}
+/////////////////////////////////////////////
+const SDL_Rect& wolf::getFrame(herd& pWolfs, int pIndex)
+{
+    if (pWolfs.direction_[pIndex] < 0)
+        return Atlas.getFrame(IdleAnimation, 0);
+    return Atlas.getFrame(pWolfs.direction_[pIndex], pWolfs.frameIndex_[pIndex]);
+}
+/////////////////////////////////////////////
+void wolf::update(herd& pWolfs, int pIndex)
+{
+    pWolfs.move(pIndex);
+    wolf::updateState(pWolfs, pIndex);
+}
+/////////////////////////////////////////////
+void wolf::updateState(herd& pWolfs, int pIndex)
+{
+    pWolfs.updateFrameDuration(pIndex);
+    //Starving is left to ground::fireStarvations, on the tick it is due
+    pWolfs.setValue(pIndex, field::preyDistance, -1);
+    pWolfs.removePropertie(pIndex, propertie::scared);
+}
+/////////////////////////////////////////////
+void wolf::update()
+{
+    wolf::update(*this->herd_, this->index_);
+}
+/////////////////////////////////////////////
+void wolf::meetShepherd(herd& pWolfs, int pWolf, herd& pShepherds, int pShepherd)
+{
+    if (pWolfs.getDistance(pWolf, pShepherds, pShepherd) < traits::FleeRadius)
+    {
+        pWolfs.addPropertie(pWolf, propertie::scared);
+        pWolfs.runAway(pWolf, pShepherds, pShepherd);
+    }
+}
+/////////////////////////////////////////////
+bool wolf::meetPrey(herd& pWolfs, int pWolf, herd& pPreys, int pPrey)
+{
+    if (!pPreys.hasPropertie(pPrey, propertie::prey))
+        return false;
+    if (pWolfs.overlap(pWolf, pPreys, pPrey))
+    {
+        //Only the deadline moves, the timing wheel catches up when the old one comes
+        pWolfs.setValue(pWolf, field::starveTick, pWolfs.now_ + traits::StarveDelay - 1);
+        return true;
+    }
+    else if (!pWolfs.hasPropertie(pWolf, propertie::scared))
+    {
+        int distance = pWolfs.getDistance(pWolf, pPreys, pPrey);
+        int preyDistance = pWolfs.getValue(pWolf, field::preyDistance);
+        if (preyDistance == -1 || preyDistance > distance)
+        {
+            pWolfs.setValue(pWolf, field::preyDistance, distance);
+            pWolfs.goToward(pWolf, pPreys, pPrey);
+        }
+    }
+    return false;
+}
+//*****************************************************************************
+//*********************************** SHEEP ***********************************
+//*****************************************************************************
+spriteAtlas sheep::Atlas;
+//*****************************************************************************
+sheep::sheep(herd* pHerd, int pIndex) :
+    renderedObject(pHerd, pIndex)
+{}
+/////////////////////////////////////////////
+herd sheep::createHerd() { return herd(species::sheep, traits::Width, traits::Height, traits::Velocity, traits::FrameInterval, traits::FrameCount); }
+/////////////////////////////////////////////
+int sheep::add(herd& pSheeps, int x, int y)
+{
+    int vIndex = pSheeps.add(x, y);
+    pSheeps.setValue(vIndex, field::procreateTick, pSheeps.now_);
+    pSheeps.addPropertie(vIndex, propertie::sheep);
+    pSheeps.addPropertie(vIndex, propertie::prey);
+    pSheeps.addPropertie(vIndex, propertie::canprocreate);
+    pSheeps.addPropertie(vIndex, pSheeps.random(vIndex) % 2 ? propertie::male : propertie::female);
+    return vIndex;
+}
+/////////////////////////////////////////////
+int sheep::add(herd& pSheeps)
+{
+    //Placed with its own stream once it exists
+    int vIndex = sheep::add(pSheeps, 0, 0);
+    pSheeps.x_[vIndex] = pSheeps.random(vIndex) % (pSheeps.worldWidth_ - traits::Width);
+    pSheeps.y_[vIndex] = pSheeps.random(vIndex) % (pSheeps.worldHeight_ - traits::Height);
+    return vIndex;
+}
+/////////////////////////////////////////////
+std::vector<std::vector<std::string>> sheep::getImagePaths()
+{
+    std::vector<std::vector<std::string>> vPathMap = createPathMap("media/sheepsF/", 10);
+    std::vector<std::vector<std::string>> vPathMapM = createPathMap("media/sheepsM/", 10);
+    vPathMap.insert(vPathMap.end(), vPathMapM.begin(), vPathMapM.end());
+    vPathMap.push_back({ "media/sheep.png" });
+    return vPathMap;
+}
+/////////////////////////////////////////////
+const SDL_Rect& sheep::getFrame(herd& pSheeps, int pIndex)
+{
+    if (pSheeps.direction_[pIndex] < 0)
+        return Atlas.getFrame(IdleAnimation, 0);
+    int vAnimation = (pSheeps.hasPropertie(pIndex, propertie::female) ? 0 : MaleAnimations) + pSheeps.direction_[pIndex];
+    return Atlas.getFrame(vAnimation, pSheeps.frameIndex_[pIndex]);
+}
+/////////////////////////////////////////////
+void sheep::update(herd& pSheeps, int pIndex)
+{
+    pSheeps.move(pIndex);
+    sheep::updateState(pSheeps, pIndex);
+}
+/////////////////////////////////////////////
+void sheep::updateState(herd& pSheeps, int pIndex)
+{
+    pSheeps.updateFrameDuration(pIndex);
+}
+/////////////////////////////////////////////
+void sheep::update()
+{
+    sheep::update(*this->herd_, this->index_);
+}
+/////////////////////////////////////////////
+//Run away a wolf
+void sheep::meetWolf(herd& pSheeps, int pSheep, herd& pWolfs, int pWolf)
+{
+    if (pSheeps.getDistance(pSheep, pWolfs, pWolf) < traits::FleeRadius)
+        pSheeps.runAway(pSheep, pWolfs, pWolf);
+}
+/////////////////////////////////////////////
+//Reproduce
+bool sheep::canMate(herd& pSheeps, int pMale, int pFemale)
+{
+    return pSheeps.hasPropertie(pMale, propertie::male) && pSheeps.hasPropertie(pFemale, propertie::female) && pSheeps.overlap(pMale, pSheeps, pFemale)
+        && pSheeps.getValue(pMale, field::procreateTick) <= pSheeps.now_ && pSheeps.getValue(pFemale, field::procreateTick) <= pSheeps.now_;
+}
+/////////////////////////////////////////////
+void sheep::mate(herd& pSheeps, int pMale, int pFemale)
+{
+    pSheeps.setValue(pMale, field::procreateTick, pSheeps.now_ + traits::ProcreateDelay);
+    pSheeps.setValue(pFemale, field::procreateTick, pSheeps.now_ + traits::ProcreateDelay);
+    pSheeps.addPropertie(pFemale, propertie::pregnant);
+}
+//*****************************************************************************
+//******************************** APPLICATION ********************************
+//*****************************************************************************
+settings::settings()
+{
+    this->sheeps_ = 0;
+    this->wolfs_ = 0;
+    this->duration_ = 0;
+    this->headless_ = false;
+    this->threads_ = std::max(1, (int)std::thread::hardware_concurrency());
+    this->seed_ = 0;
+    this->overlay_ = false;
+    this->accelerated_ = false;
+    this->worldWidth_ = frame_width;
+    this->worldHeight_ = frame_height;
+}
+/////////////////////////////////////////////
+application::application(const settings& pSettings)
+{
+    this->settings_ = pSettings;
+    this->window_ptr_ = NULL;
+    this->window_surface_ptr_ = NULL;
+    this->renderer_ = NULL;
+    this->telemetry_ = NULL;
+    this->recorder_ = NULL;
+    this->replay_ = NULL;
+    this->exporter_ = NULL;
+    this->stop_ = false;
+    this->done_ = false;
+    if (!pSettings.exportPath_.empty())
+    {
+        //Drawn off screen, in the frames of the exporter
+        this->exporter_ = new frameExporter(pSettings.exportPath_, frame_width, frame_height, pSettings.threads_);
+        if (!this->exporter_->isOpen())
+            throw std::runtime_error("Could not write " + pSettings.exportPath_);
+        this->window_surface_ptr_ = this->exporter_->acquire();
+        this->loadImages();
+    }
+    else if (!pSettings.headless_)
+    {
+        this->window_ptr_ = SDL_CreateWindow("W", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, frame_width, frame_height, 0);
+        if (this->window_ptr_ == NULL) { exit(1); }
+        if (pSettings.accelerated_)
+        {
+            //The software renderer takes over on machines without a GPU
+            this->renderer_ = SDL_CreateRenderer(this->window_ptr_, -1, SDL_RENDERER_ACCELERATED);
+            if (this->renderer_ == NULL)
+                this->renderer_ = SDL_CreateRenderer(this->window_ptr_, -1, SDL_RENDERER_SOFTWARE);
+            if (this->renderer_ == NULL) { exit(1); }
+        }
+        else
+        {
+            this->window_surface_ptr_ = SDL_GetWindowSurface(this->window_ptr_);
+            if (this->window_surface_ptr_ == NULL) { exit(1); }
+        }
+        this->loadImages();
+    }
+    if (!pSettings.replayPath_.empty())
+    {
+        //The recorded run replaces the settings given
+        this->replay_ = new replayReader();
+        if (!this->replay_->open(pSettings.replayPath_, this->settings_))
+            throw std::runtime_error("Could not replay " + pSettings.replayPath_);
+    }
+    this->setGround(this->settings_);
+    if (this->exporter_ != NULL)
+        this->ground_->getCamera().zoom(0);//As far out as it goes, the whole world is in the frames
+    if (!pSettings.recordPath_.empty())
+    {
+        this->recorder_ = new replayWriter(pSettings.recordPath_, this->settings_);
+        if (!this->recorder_->isOpen())
+            throw std::runtime_error("Could not write " + pSettings.recordPath_);
+    }
+    if (!pSettings.telemetryPath_.empty())
+    {
+        this->telemetry_ = new telemetryWriter(pSettings.telemetryPath_);
+        if (!this->telemetry_->isOpen())
+            throw std::runtime_error("Could not write " + pSettings.telemetryPath_);
+    }
+}
+/////////////////////////////////////////////
+void application::simulate()
+{
+    if (this->replay_ != NULL)
+        this->ground_->setArrowBits(this->replay_->next());
+    this->ground_->simulate();
+    if (this->recorder_ != NULL)
+        this->recorder_->record(this->ground_->getArrowsRead());
+    if (this->telemetry_ != NULL)
+        this->telemetry_->push(this->ground_->getTelemetry());
+}
+/////////////////////////////////////////////
+void application::runSimulation(int pTicks)
+{
+    //Fixed timestep, each tick waits until it is due. Beyond MaxLateTicks, the late time is dropped rather than piling up
+    const int MaxLateTicks = 5;
+    const uint64_t TickCounts = SDL_GetPerformanceFrequency() / FPS;
+    uint64_t due = SDL_GetPerformanceCounter();
+    for (int tick = 0; tick < pTicks && !this->stop_.load(std::memory_order_relaxed); tick++)
+    {
+        uint64_t now = SDL_GetPerformanceCounter();
+        if (now < due)
+            SDL_Delay((Uint32)((due - now) * 1000 / SDL_GetPerformanceFrequency()));
+        else if (now - due > MaxLateTicks * TickCounts)
+            due = now - MaxLateTicks * TickCounts;
+        this->simulate();
+        //Tick N + 1 is computed while the drawing thread shows this one
+        worldView& view = this->views_.getWriting();
+        this->ground_->publish(view);
+        view.time_ = due;
+        this->views_.publish();
+        due += TickCounts;
+    }
+    this->done_ = true;
+}
+/////////////////////////////////////////////
+void application::exportFrames(int pTicks)
+{
+    //As fast as the encoders go, the simulation waits only when every frame is still being encoded
+    for (int tick = 0; tick < pTicks; tick++)
+    {
+        this->simulate();
+        worldView& view = this->views_.getWriting();
+        this->ground_->setTarget(this->window_surface_ptr_);
+        this->ground_->publish(view);
+        this->ground_->render(view, 1);
+        this->exporter_->submit(this->window_surface_ptr_);
+        this->window_surface_ptr_ = NULL;
+        if (tick + 1 < pTicks)
+        {
+            scopedTimer vTimer(this->ground_->getProfiler(), phase::present);
+            this->window_surface_ptr_ = this->exporter_->acquire();
+        }
+    }
+}
+/////////////////////////////////////////////
+void application::loadImages()
+{
+    //Decoded once, only when there is something to draw, from the cache while it is valid
+    std::vector<spriteAtlas*> vAtlases = { &shepherd::getAtlas(), &wolf::getAtlas(), &sheep::getAtlas() };
+    std::vector<std::vector<std::vector<std::string>>> vPaths = { shepherd::getImagePaths(), wolf::getImagePaths(), sheep::getImagePaths() };
+    const std::string& vCache = this->settings_.assetsPath_;
+    if (vCache.empty() || !loadAtlasCache(vCache, vAtlases, vPaths))
+    {
+        threadPool vPool(this->settings_.threads_);
+        for (int vA = 0; vA < (int)vAtlases.size(); vA++)
+            vAtlases[vA]->load(vPaths[vA], vPool);
+        if (!vCache.empty() && !saveAtlasCache(vCache, vAtlases, vPaths))
+            std::cerr << "Could not write " << vCache << std::endl;
+    }
+    //Then in the format they are drawn in
+    for (spriteAtlas* vAtlas : vAtlases)
+        if (this->renderer_ != NULL)
+            vAtlas->upload(this->renderer_);
+        else
+            vAtlas->optimize(this->window_surface_ptr_->format);
+}
+/////////////////////////////////////////////
+void application::setGround(const settings& pSettings)
+{
+    this->ground_ = new ground(this->window_surface_ptr_, pSettings.threads_, pSettings.seed_);
+    this->ground_->setOverlay(pSettings.overlay_);
+    this->ground_->setRenderer(this->renderer_);
+    if (!pSettings.loadPath_.empty())
+    {
+        //The snapshot brings its own world and agents
+        if (!this->ground_->loadSnapshot(pSettings.loadPath_))
+            throw std::runtime_error("Could not load " + pSettings.loadPath_);
+        return;
+    }
+    this->ground_->setWorld(pSettings.worldWidth_, pSettings.worldHeight_);
+    //Room for the herd to double before the columns have to grow
+    this->ground_->reserve(pSettings.sheeps_ * 2, pSettings.wolfs_);
+    for (int sheepNbr = 0; sheepNbr < pSettings.sheeps_; sheepNbr++)
+        this->ground_->addSheep();
+    for (int wolfNbr = 0; wolfNbr < pSettings.wolfs_; wolfNbr++)
+        this->ground_->addWolf();
+    this->ground_->addShepherd();
+}
+/////////////////////////////////////////////
+void application::loop(int duration)
+{
+    SDL_Event e;
+    //A run lasts duration seconds of simulated time, rendered or not, a replay as long as its log
+    int ticks = (this->replay_ != NULL ? this->replay_->getTicks() : duration * FPS);
+    if (this->exporter_ != NULL)
+        this->exportFrames(ticks);
+    else if (this->window_ptr_ == NULL)
+    {
+        for (int tick = 0; tick < ticks; tick++)
+            this->simulate();
+    }
+    //The simulation runs on its own thread, this one handles the events and draws the views it publishes
+    const double TickDuration = 1.0 / FPS;
+    const double Frequency = (double)SDL_GetPerformanceFrequency();
+    std::thread simulation;
+    if (this->window_ptr_ != NULL)
+    {
+        if (this->replay_ == NULL)
+            this->ground_->setArrows(SDL_GetKeyboardState(NULL));
+        this->ground_->publish(this->views_.getWriting());
+        this->views_.getWriting().time_ = SDL_GetPerformanceCounter();
+        this->views_.publish();
+        simulation = std::thread(&application::runSimulation, this, ticks);
+    }
+    while (this->window_ptr_ != NULL && !this->done_)
+    {
+        //Check if cross clicked, the run then ends at the tick being computed. The wheel zooms
+        while (SDL_PollEvent(&e))
+        {
+            if (e.type == SDL_QUIT)
+                this->stop_ = true;
+            if (e.type == SDL_MOUSEWHEEL && e.wheel.y != 0)
+                this->ground_->getCamera().zoom(e.wheel.y > 0 ? 1.25f : 0.8f);
+        }
+        if (this->stop_)
+            break;
+        //WASD scrolls the camera, the arrows are for the shepherd
+        const Uint8* keys = SDL_GetKeyboardState(NULL);
+        const float ScrollSpeed = 12;//Window pixels per frame
+        this->ground_->getCamera().scroll((keys[SDL_SCANCODE_D] - keys[SDL_SCANCODE_A]) * ScrollSpeed, (keys[SDL_SCANCODE_S] - keys[SDL_SCANCODE_W]) * ScrollSpeed);
+        if (this->replay_ == NULL)
+            this->ground_->setArrows(keys);
+        //Update screen, between the last published tick and the one before
+        bool fresh = this->views_.acquire();
+        worldView& view = this->views_.getReading();
+        double elapsed = (double)(SDL_GetPerformanceCounter() - view.time_) / Frequency;
+        this->ground_->render(view, (float)std::min(1.0, elapsed / TickDuration));
+        {
+            //Only what changed goes to the screen
+            scopedTimer vTimer(this->ground_->getProfiler(), phase::present);
+            const std::vector<SDL_Rect>& damage = this->ground_->getDamage();
+            if (this->renderer_ != NULL)
+                SDL_RenderPresent(this->renderer_);
+            else if (!damage.empty())
+                SDL_UpdateWindowSurfaceRects(this->window_ptr_, damage.data(), (int)damage.size());
+        }
+        //Wait, only if the next tick is not due yet, at least a little when there was nothing new
+        double idle = TickDuration - (double)(SDL_GetPerformanceCounter() - view.time_) / Frequency;
+        if (idle > 0)
+            SDL_Delay((Uint32)(idle * 1000));
+        else if (!fresh)
+            SDL_Delay(1);
+    }
+    if (simulation.joinable())
+        simulation.join();
+    std::cout << "sheep: " << this->ground_->countObjects(propertie::sheep)
+        << " wolves: " << this->ground_->countObjects(propertie::wolf) << std::endl;
+    if (!this->settings_.profilePath_.empty() && !this->ground_->getProfiler().writeCsv(this->settings_.profilePath_))
+        std::cerr << "Could not write " << this->settings_.profilePath_ << std::endl;
+    if (!this->settings_.savePath_.empty() && !this->ground_->saveSnapshot(this->settings_.savePath_))
+        std::cerr << "Could not write " << this->settings_.savePath_ << std::endl;
+    if (this->telemetry_ != NULL)
+        this->telemetry_->close();
+    if (this->recorder_ != NULL)
+        this->recorder_->close();
+    if (this->exporter_ != NULL && !this->exporter_->close())
+        std::cerr << "Could not write " << this->settings_.exportPath_ << std::endl;
+}
+//*****************************************************************************
+// ******************************* SPATIAL GRID *******************************
+//*****************************************************************************
+spatialGrid::spatialGrid()
+{
+    this->cellSize_ = 1;
+    this->columns_ = 0;
+    this->rows_ = 0;
+}
+/////////////////////////////////////////////
+int spatialGrid::getColumn(int x) { return std::min(std::max(x / this->cellSize_, 0), this->columns_ - 1); }
+int spatialGrid::getRow(int y) { return std::min(std::max(y / this->cellSize_, 0), this->rows_ - 1); }
+int spatialGrid::getCell(int x, int y) { return this->getRow(y) * this->columns_ + this->getColumn(x); }
+/////////////////////////////////////////////
+void spatialGrid::build(herd& pHerd, int pCellSize)
+{
+    this->cellSize_ = std::max(pCellSize, 1);
+    this->columns_ = pHerd.worldWidth_ / this->cellSize_ + 1;
+    this->rows_ = pHerd.worldHeight_ / this->cellSize_ + 1;
+    //Counting sort of the agents by cell
+    this->cellStarts_.assign(this->columns_ * this->rows_ + 1, 0);
+    this->objectCells_.resize(pHerd.size());
+    this->cellObjects_.resize(pHerd.size());
+    for (int vO = 0; vO < pHerd.size(); vO++)
+    {
+        this->objectCells_[vO] = this->getCell(pHerd.getXBox(vO), pHerd.getYBox(vO));
+        this->cellStarts_[this->objectCells_[vO]]++;
+    }
+    for (int vCell = 1; vCell <= this->columns_ * this->rows_; vCell++)
+        this->cellStarts_[vCell] += this->cellStarts_[vCell - 1];
+    //Filled backwards so the agents of a cell stay in ascending order
+    for (int vO = pHerd.size() - 1; vO >= 0; vO--)
+        this->cellObjects_[--this->cellStarts_[this->objectCells_[vO]]] = vO;
+}
+/////////////////////////////////////////////
+void spatialGrid::getOverlapping(herd& pHerd, int pIndex, herd& pTargets, std::vector<int>& pOverlapping)
+{
+    //An agent is stored by the corner of its box, the box can start up to a cell before
+    int vX = pHerd.getXBox(pIndex);
+    int vY = pHerd.getYBox(pIndex);
+    for (int vR = this->getRow(vY - this->cellSize_); vR <= this->getRow(vY + pHerd.getHeightBox()); vR++)
+        for (int vC = this->getColumn(vX - this->cellSize_); vC <= this->getColumn(vX + pHerd.getWidthBox()); vC++)
+        {
+            int vCell = vR * this->columns_ + vC;
+            for (int vI = this->cellStarts_[vCell]; vI < this->cellStarts_[vCell + 1]; vI++)
+                if (pHerd.overlap(pIndex, pTargets, this->cellObjects_[vI]))
+                    pOverlapping.push_back(this->cellObjects_[vI]);
+        }
+}
+/////////////////////////////////////////////
+int spatialGrid::findNearest(herd& pHerd, int pIndex, herd& pTargets, propertie pPropertie, int pMaxDistance, bool pSkipOverlapping, int pBelow)
+{
+    //Same answer as herd::getDistance over every target, the lowest index wins a tie
+    int vColumn = this->getColumn(pHerd.getXBox(pIndex));
+    int vRow = this->getRow(pHerd.getYBox(pIndex));
+    int vBest = -1;
+    int vBestDistance = pMaxDistance;
+    for (int vRing = 0; vRing <= std::max(this->columns_, this->rows_); vRing++)
+    {
+        //A box is less than a cell wide, so the targets of this ring are at least vRing - 2 cells away
+        int vMinDistance = std::max(vRing - 2, 0) * this->cellSize_;
+        if (vMinDistance > vBestDistance || (vBest == -1 && vMinDistance >= pMaxDistance))
+            break;
+        for (int vR = std::max(vRow - vRing, 0); vR <= std::min(vRow + vRing, this->rows_ - 1); vR++)
+        {
+            //Only the border of the ring
+            int vStep = (vR == vRow - vRing || vR == vRow + vRing ? 1 : 2 * vRing);
+            for (int vC = vColumn - vRing; vC <= vColumn + vRing; vC += vStep)
+            {
+                if (vC < 0 || vC >= this->columns_)
+                    continue;
+                int vCell = vR * this->columns_ + vC;
+                for (int vI = this->cellStarts_[vCell]; vI < this->cellStarts_[vCell + 1]; vI++)
+                {
+                    int vT = this->cellObjects_[vI];
+                    if (vT >= pBelow || !pTargets.hasPropertie(vT, pPropertie) || (pSkipOverlapping && pHerd.overlap(pIndex, pTargets, vT)))
+                        continue;
+                    int vDistance = pHerd.getDistance(pIndex, pTargets, vT);
+                    if (vDistance < vBestDistance || (vDistance == vBestDistance && vBest != -1 && vT < vBest))
+                    {
+                        vBest = vT;
+                        vBestDistance = vDistance;
+                    }
+                }
+            }
+        }
+    }
+    return vBest;
+}
+/////////////////////////////////////////////
+void spatialGrid::getInBox(int pLeft, int pTop, int pRight, int pBottom, std::vector<int>& pFound)
+{
+    for (int vR = this->getRow(pTop); vR <= this->getRow(pBottom); vR++)
+        for (int vC = this->getColumn(pLeft); vC <= this->getColumn(pRight); vC++)
+        {
+            int vCell = vR * this->columns_ + vC;
+            pFound.insert(pFound.end(), this->cellObjects_.begin() + this->cellStarts_[vCell], this->cellObjects_.begin() + this->cellStarts_[vCell + 1]);
+        }
+}
+/////////////////////////////////////////////
+void spatialGrid::reserve(int pCount)
+{
+    this->objectCells_.reserve(pCount);
+    this->cellObjects_.reserve(pCount);
+}
+/////////////////////////////////////////////
+void spatialGrid::getNeighbours(int pIndex, std::vector<int>& pNeighbours)
+{
+    int vColumn = this->objectCells_[pIndex] % this->columns_;
+    int vRow = this->objectCells_[pIndex] / this->columns_;
+    for (int vR = std::max(vRow - 1, 0); vR <= std::min(vRow + 1, this->rows_ - 1); vR++)
+        for (int vC = std::max(vColumn - 1, 0); vC <= std::min(vColumn + 1, this->columns_ - 1); vC++)
+        {
+            int vCell = vR * this->columns_ + vC;
+            for (int vI = this->cellStarts_[vCell]; vI < this->cellStarts_[vCell + 1]; vI++)
+                pNeighbours.push_back(this->cellObjects_[vI]);
+        }
+}
+//*****************************************************************************
+// ******************************** THREAD POOL *******************************
+//*****************************************************************************
+threadPool::threadPool(int pThreadCount)
+{
+    this->task_ = NULL;
+    this->count_ = 0;
+    this->chunkSize_ = 1;
+    this->chunkCount_ = 0;
+    this->nextChunk_ = 0;
+    this->generation_ = 0;
+    this->busy_ = 0;
+    this->stop_ = false;
+    //The calling thread works too
+    for (int vThread = 1; vThread < pThreadCount; vThread++)
+        this->workers_.emplace_back(&threadPool::workerLoop, this, vThread);
+}
+/////////////////////////////////////////////
+threadPool::~threadPool()
+{
+    {
+        std::lock_guard<std::mutex> vLock(this->mutex_);
+        this->stop_ = true;
+    }
+    this->start_.notify_all();
+    for (std::thread& vWorker : this->workers_)
+        vWorker.join();
+}
+/////////////////////////////////////////////
+void threadPool::run(int pCount, int pChunkSize, const std::function<void(int, int, int, int)>& pTask)
+{
+    int vChunkCount = (pCount + pChunkSize - 1) / pChunkSize;
+    if (this->workers_.empty() || vChunkCount <= 1)
+    {
+        for (int vChunk = 0; vChunk < vChunkCount; vChunk++)
+            pTask(vChunk * pChunkSize, std::min(pCount, (vChunk + 1) * pChunkSize), vChunk, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> vLock(this->mutex_);
+        this->task_ = &pTask;
+        this->count_ = pCount;
+        this->chunkSize_ = pChunkSize;
+        this->chunkCount_ = vChunkCount;
+        this->nextChunk_ = 0;
+        this->busy_ = (int)this->workers_.size();
+        this->generation_++;
+    }
+    this->start_.notify_all();
+    this->work(0);
+    std::unique_lock<std::mutex> vLock(this->mutex_);
+    this->done_.wait(vLock, [this] { return this->busy_ == 0; });
+}
+/////////////////////////////////////////////
+void threadPool::work(int pThread)
+{
+    int vChunk;
+    while ((vChunk = this->nextChunk_++) < this->chunkCount_)
+        (*this->task_)(vChunk * this->chunkSize_, std::min(this->count_, (vChunk + 1) * this->chunkSize_), vChunk, pThread);
+}
+/////////////////////////////////////////////
+void threadPool::workerLoop(int pThread)
+{
+    int vGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> vLock(this->mutex_);
+            this->start_.wait(vLock, [&] { return this->stop_ || this->generation_ != vGeneration; });
+            if (this->stop_)
+                return;
+            vGeneration = this->generation_;
+        }
+        this->work(pThread);
+        {
+            std::lock_guard<std::mutex> vLock(this->mutex_);
+            if (--this->busy_ == 0)
+                this->done_.notify_one();
+        }
+    }
+}
+//*****************************************************************************
+// ****************************** COMMAND BUFFER ******************************
+//*****************************************************************************
+void commandBuffer::clear()
+{
+    this->kills_.clear();
+    this->couples_.clear();
+}
+/////////////////////////////////////////////
+void commandBuffer::reserve(int pSheeps)
+{
+    //A grid query never returns more than the whole herd, nor a tick more couples. A sheep eaten by several wolves is
+    //killed more than once, the kills of a tick would still need most of the herd eaten twice to go beyond
+    this->kills_.reserve(pSheeps);
+    this->couples_.reserve(pSheeps);
+    this->neighbours_.reserve(pSheeps);
+}
+/////////////////////////////////////////////
+chunkRecord::chunkRecord()
+{
+    this->buffer_ = NULL;
+    this->firstKill_ = 0;
+    this->endKill_ = 0;
+    this->firstCouple_ = 0;
+    this->endCouple_ = 0;
+    this->pairs_ = 0;
+    this->threats_ = 0;
+    this->threatDistances_ = 0;
+}
+/////////////////////////////////////////////
+void chunkRecord::begin(commandBuffer& pBuffer)
+{
+    this->buffer_ = &pBuffer;
+    this->firstKill_ = (int)pBuffer.kills_.size();
+    this->firstCouple_ = (int)pBuffer.couples_.size();
+    this->pairs_ = 0;
+    this->threats_ = 0;
+    this->threatDistances_ = 0;
+}
+/////////////////////////////////////////////
+void chunkRecord::end()
+{
+    this->endKill_ = (int)this->buffer_->kills_.size();
+    this->endCouple_ = (int)this->buffer_->couples_.size();
+}
+//*****************************************************************************
+// ********************************* PROFILER *********************************
+//*****************************************************************************
+tickRecord::tickRecord()
+{
+    for (uint64_t& vDuration : this->durations_)
+        vDuration = 0;
+    this->sheeps_ = 0;
+    this->wolfs_ = 0;
+    this->pairs_ = 0;
+}
+/////////////////////////////////////////////
+profiler::profiler()
+{
+    this->records_.resize(profiler::Capacity);
+    this->scratch_.reserve(profiler::Capacity);
+    this->next_ = 0;
+    this->count_ = 0;
+    this->ticks_ = 0;
+    for (std::atomic<uint64_t>& vDuration : this->durations_)
+        vDuration = 0;
+}
+/////////////////////////////////////////////
+const char* profiler::getPhaseName(phase pPhase)
+{
+    static const char* Names[] = { "interact", "update", "removeDeads", "addNews", "drawGround", "drawAgents", "present" };
+    return Names[(int)pPhase];
+}
+/////////////////////////////////////////////
+double profiler::toMicroseconds(uint64_t pDuration)
+{
+    static const double Frequency = (double)SDL_GetPerformanceFrequency();
+    return pDuration * 1000000.0 / Frequency;
+}
+/////////////////////////////////////////////
+void profiler::endTick(int pSheeps, int pWolfs)
+{
+    this->current_.sheeps_ = pSheeps;
+    this->current_.wolfs_ = pWolfs;
+    for (int vP = 0; vP < (int)phase::count; vP++)
+        this->current_.durations_[vP] = this->durations_[vP].exchange(0, std::memory_order_relaxed);
+    this->records_[this->next_] = this->current_;
+    this->next_ = (this->next_ + 1) % profiler::Capacity;
+    this->count_ = std::min(this->count_ + 1, (int)profiler::Capacity);
+    this->ticks_++;
+    this->current_ = tickRecord();
+}
+/////////////////////////////////////////////
+const tickRecord& profiler::getLast()
+{
+    return this->records_[(this->next_ + profiler::Capacity - 1) % profiler::Capacity];
+}
+/////////////////////////////////////////////
+double profiler::getPercentile(phase pPhase, double pRank)
+{
+    if (this->count_ == 0)
+        return 0;
+    this->scratch_.clear();
+    for (int vR = 0; vR < this->count_; vR++)
+        this->scratch_.push_back(profiler::toMicroseconds(this->records_[vR].durations_[(int)pPhase]));
+    std::vector<double>::iterator vIt = this->scratch_.begin() + (int)(pRank * (this->count_ - 1));
+    std::nth_element(this->scratch_.begin(), vIt, this->scratch_.end());
+    return *vIt;
+}
+/////////////////////////////////////////////
+bool profiler::writeCsv(const std::string& pPath)
+{
+    //One line per tick kept, oldest first, then the p50 and p99 of every phase
+    std::ofstream vFile(pPath);
+    if (!vFile)
+        return false;
+    vFile << "tick,sheeps,wolfs,pairs";
+    for (int vP = 0; vP < (int)phase::count; vP++)
+        vFile << "," << profiler::getPhaseName((phase)vP) << "_us";
+    vFile << "\n";
+    int vFirst = (this->count_ < profiler::Capacity ? 0 : this->next_);
+    for (int vR = 0; vR < this->count_; vR++)
+    {
+        const tickRecord& vRecord = this->records_[(vFirst + vR) % profiler::Capacity];
+        vFile << this->ticks_ - this->count_ + vR << "," << vRecord.sheeps_ << "," << vRecord.wolfs_ << "," << vRecord.pairs_;
+        for (int vP = 0; vP < (int)phase::count; vP++)
+            vFile << "," << profiler::toMicroseconds(vRecord.durations_[vP]);
+        vFile << "\n";
+    }
+    const char* Ranks[] = { "p50", "p99" };
+    const double Values[] = { 0.5, 0.99 };
+    for (int vK = 0; vK < 2; vK++)
+    {
+        vFile << Ranks[vK] << ",,,";
+        for (int vP = 0; vP < (int)phase::count; vP++)
+            vFile << "," << this->getPercentile((phase)vP, Values[vK]);
+        vFile << "\n";
+    }
+    return true;
+}
+/////////////////////////////////////////////
+scopedTimer::scopedTimer(profiler& pProfiler, phase pPhase) :
+    profiler_(pProfiler)
+{
+    this->phase_ = pPhase;
+    this->start_ = SDL_GetPerformanceCounter();
+}
+/////////////////////////////////////////////
+scopedTimer::~scopedTimer()
+{
+    this->profiler_.add(this->phase_, SDL_GetPerformanceCounter() - this->start_);
+}
+//*****************************************************************************
+// ******************************** TELEMETRY *********************************
+//*****************************************************************************
+telemetryRecord::telemetryRecord()
+{
+    this->tick_ = 0;
+    this->sheeps_ = 0;
+    this->wolfs_ = 0;
+    this->births_ = 0;
+    this->predations_ = 0;
+    this->starvations_ = 0;
+    this->preyDistance_ = -1;
+    this->threatDistance_ = -1;
+}
+/////////////////////////////////////////////
+telemetryWriter::telemetryWriter(const std::string& pPath) :
+    file_(pPath, std::ios::binary)
+{
+    const char* Names[] = { "tick", "sheeps", "wolfs", "births", "predations", "starvations", "prey_distance", "threat_distance" };
+    const char Types[] = "iiiiiiff";//int32 or float32, in the order of the names
+    this->binary_ = !(pPath.size() >= 4 && pPath.compare(pPath.size() - 4, 4, ".csv") == 0);
+    this->closing_ = false;
+    if (!this->file_)
+        return;
+    if (this->binary_)
+    {
+        //Magic, version, column count, then the type and name of every column
+        uint32_t vHeader[2] = { 1, 8 };
+        this->file_.write("WSTELEM", 8);
+        this->file_.write((const char*)vHeader, sizeof(vHeader));
+        for (int vC = 0; vC < 8; vC++)
+        {
+            this->file_.put(Types[vC]);
+            this->file_.write(Names[vC], strlen(Names[vC]) + 1);
+        }
+    }
+    else
+        for (int vC = 0; vC < 8; vC++)
+            this->file_ << Names[vC] << (vC < 7 ? "," : "\n");
+    this->pending_.reserve(BatchSize);
+    this->writing_.reserve(BatchSize);
+    this->thread_ = std::thread([this]() { this->run(); });
+}
+/////////////////////////////////////////////
+telemetryWriter::~telemetryWriter()
+{
+    this->close();
+}
+/////////////////////////////////////////////
+void telemetryWriter::push(const telemetryRecord& pRecord)
+{
+    //Never waits for the disk : the thread only holds the lock to take the queue
+    std::lock_guard<std::mutex> vLock(this->mutex_);
+    this->pending_.push_back(pRecord);
+    if (this->pending_.size() >= BatchSize)
+        this->wake_.notify_one();
+}
+/////////////////////////////////////////////
+void telemetryWriter::close()
+{
+    if (!this->thread_.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> vLock(this->mutex_);
+        this->closing_ = true;
+    }
+    this->wake_.notify_one();
+    this->thread_.join();
+    this->file_.close();
+}
+/////////////////////////////////////////////
+void telemetryWriter::run()
+{
+    while (true)
+    {
+        bool vLast;
+        {
+            std::unique_lock<std::mutex> vLock(this->mutex_);
+            this->wake_.wait(vLock, [this]() { return this->closing_ || this->pending_.size() >= BatchSize; });
+            std::swap(this->pending_, this->writing_);
+            vLast = this->closing_;
+        }
+        this->write(this->writing_);
+        this->writing_.clear();
+        if (vLast)
+            return;
+    }
+}
+/////////////////////////////////////////////
+template <class T> void telemetryWriter::appendColumn(const std::vector<telemetryRecord>& pRecords, T telemetryRecord::* pMember)
+{
+    for (const telemetryRecord& vRecord : pRecords)
+    {
+        const char* vValue = (const char*)&(vRecord.*pMember);
+        this->scratch_.insert(this->scratch_.end(), vValue, vValue + sizeof(T));
+    }
+}
+/////////////////////////////////////////////
+void telemetryWriter::write(const std::vector<telemetryRecord>& pRecords)
+{
+    if (pRecords.empty())
+        return;
+    if (!this->binary_)
+    {
+        for (const telemetryRecord& vRecord : pRecords)
+            this->file_ << vRecord.tick_ << "," << vRecord.sheeps_ << "," << vRecord.wolfs_ << "," << vRecord.births_ << ","
+                << vRecord.predations_ << "," << vRecord.starvations_ << "," << vRecord.preyDistance_ << "," << vRecord.threatDistance_ << "\n";
+        return;
+    }
+    //A block : its number of records, then each column in one piece
+    uint32_t vCount = (uint32_t)pRecords.size();
+    this->scratch_.assign((const char*)&vCount, (const char*)&vCount + sizeof(vCount));
+    this->appendColumn(pRecords, &telemetryRecord::tick_);
+    this->appendColumn(pRecords, &telemetryRecord::sheeps_);
+    this->appendColumn(pRecords, &telemetryRecord::wolfs_);
+    this->appendColumn(pRecords, &telemetryRecord::births_);
+    this->appendColumn(pRecords, &telemetryRecord::predations_);
+    this->appendColumn(pRecords, &telemetryRecord::starvations_);
+    this->appendColumn(pRecords, &telemetryRecord::preyDistance_);
+    this->appendColumn(pRecords, &telemetryRecord::threatDistance_);
+    this->file_.write(this->scratch_.data(), this->scratch_.size());
+}
+//*****************************************************************************
+// ********************************* SNAPSHOT *********************************
+//*****************************************************************************
+static size_t alignSnapshot(size_t pSize) { return (pSize + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment; }
+/////////////////////////////////////////////
+static void appendBytes(std::vector<char>& pOut, const void* pData, size_t pSize)
+{
+    const char* vBytes = (const char*)pData;
+    pOut.insert(pOut.end(), vBytes, vBytes + pSize);
+}
+/////////////////////////////////////////////
+static void appendString(std::vector<char>& pOut, const std::string& pString)
+{
+    uint32_t vLength = (uint32_t)pString.size();
+    appendBytes(pOut, &vLength, sizeof(vLength));
+    appendBytes(pOut, pString.data(), vLength);
+}
+/////////////////////////////////////////////
+//Reads in a buffer that may be too short, every read after a failure fails too
+class snapshotReader
+{
+public:
+    const char* data_;
+    size_t size_;
+    size_t position_;
+    bool failed_;
+
+    snapshotReader(const char* pData, size_t pSize) : data_(pData), size_(pSize), position_(0), failed_(false) {}
+    bool read(void* pOut, size_t pSize)
+    {
+        this->failed_ = this->failed_ || pSize > this->size_ - this->position_;
+        if (this->failed_)
+            return false;
+        memcpy(pOut, this->data_ + this->position_, pSize);
+        this->position_ += pSize;
+        return true;
+    }
+    uint32_t readInt()
+    {
+        uint32_t vValue = 0;
+        this->read(&vValue, sizeof(vValue));
+        return vValue;
+    }
+    std::string readString()
+    {
+        uint32_t vLength = this->readInt();
+        if (this->failed_ || vLength > this->size_ - this->position_)
+        {
+            this->failed_ = true;
+            return std::string();
+        }
+        std::string vString(this->data_ + this->position_, vLength);
+        this->position_ += vLength;
+        return vString;
+    }
+};
+/////////////////////////////////////////////
+mappedFile::mappedFile(const std::string& pPath)
+{
+    this->data_ = NULL;
+    this->size_ = 0;
+    this->handles_[0] = NULL;
+    this->handles_[1] = NULL;
+#ifdef _WIN32
+    HANDLE vFile = CreateFileA(pPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER vSize;
+    if (vFile == INVALID_HANDLE_VALUE)
+        return;
+    this->handles_[0] = vFile;
+    if (!GetFileSizeEx(vFile, &vSize) || vSize.QuadPart == 0)
+        return;
+    HANDLE vMapping = CreateFileMappingA(vFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (vMapping == NULL)
+        return;
+    this->handles_[1] = vMapping;
+    this->data_ = (const char*)MapViewOfFile(vMapping, FILE_MAP_READ, 0, 0, 0);
+    this->size_ = (this->data_ != NULL ? (size_t)vSize.QuadPart : 0);
+#else
+    int vFile = open(pPath.c_str(), O_RDONLY);
+    struct stat vStat;
+    if (vFile < 0)
+        return;
+    if (fstat(vFile, &vStat) == 0 && vStat.st_size > 0)
+    {
+        void* vData = mmap(NULL, (size_t)vStat.st_size, PROT_READ, MAP_PRIVATE, vFile, 0);
+        if (vData != MAP_FAILED)
+        {
+            madvise(vData, (size_t)vStat.st_size, MADV_SEQUENTIAL);
+            this->data_ = (const char*)vData;
+            this->size_ = (size_t)vStat.st_size;
+        }
+    }
+    close(vFile);
+#endif
+}
+/////////////////////////////////////////////
+mappedFile::~mappedFile()
+{
+#ifdef _WIN32
+    if (this->data_ != NULL)
+        UnmapViewOfFile(this->data_);
+    if (this->handles_[1] != NULL)
+        CloseHandle(this->handles_[1]);
+    if (this->handles_[0] != NULL)
+        CloseHandle(this->handles_[0]);
+#else
+    if (this->data_ != NULL)
+        munmap((void*)this->data_, this->size_);
+#endif
+}
+/////////////////////////////////////////////
+void herd::save(std::vector<char>& pOut)
+{
+    //Slow path values first, by serial
+    std::vector<char> vExtras;
+    for (const std::pair<const uint32_t, extraRecord>& vRecord : this->extras_)
+    {
+        uint32_t vHeader[2] = { vRecord.first, (uint32_t)vRecord.second.values_.size() };
+        appendBytes(vExtras, vHeader, sizeof(vHeader));
+        for (const std::pair<const std::string, int>& vValue : vRecord.second.values_)
+        {
+            appendString(vExtras, vValue.first);
+            appendBytes(vExtras, &vValue.second, sizeof(vValue.second));
+        }
+        uint32_t vCount = (uint32_t)vRecord.second.properties_.size();
+        appendBytes(vExtras, &vCount, sizeof(vCount));
+        for (const std::string& vPropertie : vRecord.second.properties_)
+            appendString(vExtras, vPropertie);
+    }
+
+    herdHeader vHeader = {};
+    vHeader.species_ = (uint32_t)this->species_;
+    vHeader.count_ = (uint32_t)this->size();
+    this->forEachColumn([&](auto&) { vHeader.columnCount_++; });
+    vHeader.nextSerial_ = this->nextSerial_;
+    vHeader.worldWidth_ = this->worldWidth_;
+    vHeader.worldHeight_ = this->worldHeight_;
+    vHeader.seed_ = this->seed_;
+    vHeader.extrasSize_ = vExtras.size();
+    appendBytes(pOut, &vHeader, sizeof(vHeader));
+    //Each column in one copy
+    this->forEachColumn([&](auto& pColumn) {
+        appendBytes(pOut, pColumn.data(), pColumn.size() * sizeof(pColumn[0]));
+        pOut.resize(alignSnapshot(pOut.size()));
+    });
+    appendBytes(pOut, vExtras.data(), vExtras.size());
+    pOut.resize(alignSnapshot(pOut.size()));
+}
+/////////////////////////////////////////////
+size_t herd::load(const char* pData, size_t pSize)
+{
+    herdHeader vHeader;
+    int vColumnCount = 0;
+    this->forEachColumn([&](auto&) { vColumnCount++; });
+    if (pSize < sizeof(vHeader))
+        return 0;
+    memcpy(&vHeader, pData, sizeof(vHeader));
+    size_t vColumnSize = alignSnapshot((size_t)vHeader.count_ * 4);
+    size_t vSize = sizeof(vHeader) + vColumnCount * vColumnSize + alignSnapshot(vHeader.extrasSize_);
+    if (vHeader.species_ != (uint32_t)this->species_ || (int)vHeader.columnCount_ != vColumnCount || vSize > pSize)
+        return 0;
+    this->nextSerial_ = vHeader.nextSerial_;
+    this->worldWidth_ = vHeader.worldWidth_;
+    this->worldHeight_ = vHeader.worldHeight_;
+    this->seed_ = vHeader.seed_;
+    //Each column in one copy, the agents have not been drawn yet
+    int vCount = (int)vHeader.count_;
+    const char* vColumn = pData + sizeof(vHeader);
+    this->forEachColumn([&](auto& pColumn) {
+        pColumn.resize(vCount);
+        memcpy(pColumn.data(), vColumn, vCount * sizeof(pColumn[0]));
+        vColumn += vColumnSize;
+    });
+    this->extras_.clear();
+    snapshotReader vReader(vColumn, vHeader.extrasSize_);
+    while (vReader.position_ < vReader.size_ && !vReader.failed_)
+    {
+        uint32_t vSerial = vReader.readInt();
+        uint32_t vValues = vReader.readInt();
+        if (vReader.failed_ || vSerial >= this->nextSerial_)
+            break;
+        extraRecord& vRecord = this->extras_[vSerial];
+        for (uint32_t vV = 0; vV < vValues && !vReader.failed_; vV++)
+        {
+            std::string vKey = vReader.readString();
+            int vValue = 0;
+            vReader.read(&vValue, sizeof(vValue));
+            vRecord.values_[vKey] = vValue;
+        }
+        uint32_t vProperties = vReader.readInt();
+        for (uint32_t vP = 0; vP < vProperties && !vReader.failed_; vP++)
+            vRecord.properties_.push_back(vReader.readString());
+    }
+    return vSize;
+}
+/////////////////////////////////////////////
+bool ground::saveSnapshot(const std::string& pPath)
+{
+    //Built in memory, then written at once
+    std::vector<char> vData(sizeof(snapshotHeader));
+    size_t vCapacity = sizeof(snapshotHeader);
+    for (herd* vHerd : { &this->shepherds_, &this->wolfs_, &this->sheeps_ })
+        vHerd->forEachColumn([&](auto& pColumn) { vCapacity += alignSnapshot(pColumn.size() * 4); });
+    vData.reserve(vCapacity + 6 * SnapshotAlignment);//Plus the herd headers and their slow path values
+    for (herd* vHerd : { &this->shepherds_, &this->wolfs_, &this->sheeps_ })
+        vHerd->save(vData);
+    snapshotHeader vHeader = {};
+    memcpy(vHeader.magic_, "WSSNAP", 6);
+    vHeader.version_ = SnapshotVersion;
+    vHeader.herdCount_ = 3;
+    vHeader.size_ = vData.size();
+    vHeader.tick_ = this->tick_;
+    vHeader.lambSerial_ = this->lambSerial_;
+    memcpy(vData.data(), &vHeader, sizeof(vHeader));
+    std::ofstream vFile(pPath, std::ios::binary);
+    return vFile.write(vData.data(), vData.size()) ? true : false;
+}
+/////////////////////////////////////////////
+bool ground::loadSnapshot(const std::string& pPath)
 {
-    return this->values_.count(pKey);
+    //Mapped, then each column is copied in one go
+    mappedFile vFile(pPath);
+    if (!vFile.isOpen() || vFile.getSize() < sizeof(snapshotHeader))
+        return false;
+    snapshotHeader vHeader;
+    memcpy(&vHeader, vFile.getData(), sizeof(vHeader));
+    if (memcmp(vHeader.magic_, "WSSNAP\0\0", 8) != 0 || vHeader.version_ != SnapshotVersion || vHeader.herdCount_ != 3 || vHeader.size_ != vFile.getSize())
+        return false;
+    size_t vPosition = sizeof(vHeader);
+    for (herd* vHerd : { &this->shepherds_, &this->wolfs_, &this->sheeps_ })
+    {
+        size_t vRead = vHerd->load(vFile.getData() + vPosition, vFile.getSize() - vPosition);
+        if (vRead == 0)
+            return false;
+        vPosition += vRead;
+    }
+    //Every wolf is due again at its own deadline, nothing of the old world stays drawn
+    this->tick_ = (int)vHeader.tick_;
+    this->lambSerial_ = (uint32_t)vHeader.lambSerial_;
+    for (drawnHerd& vDrawn : this->drawn_)
+        vDrawn.clear();
+    this->starvations_.clear();
+    for (herd* vHerd : { &this->shepherds_, &this->wolfs_, &this->sheeps_ })
+        vHerd->now_ = this->tick_;
+    for (int vW = 0; vW < this->wolfs_.size(); vW++)
+        this->starvations_.schedule(std::max(this->wolfs_.getValue(vW, field::starveTick), this->tick_), vW);
+    //The view follows the loaded world
+    int vWidth = this->sheeps_.worldWidth_;
+    int vHeight = this->sheeps_.worldHeight_;
+    this->camera_ = camera(vWidth, vHeight);
+    this->camera_.centerOn(vWidth / 2.0f, vHeight / 2.0f);
+    if (this->window_surface_ptr_ != NULL)
+        this->drawGround();
+    return true;
 }
-/////////////////////////////////////////////
-int object::getValue(std::string pKey)
+//*****************************************************************************
+// ******************************** ATLAS CACHE *******************************
+//*****************************************************************************
+void spriteAtlas::save(std::vector<char>& pOut)
 {
-    return this->values_[pKey];
+    uint32_t vCounts[4] = { (uint32_t)this->frames_.size(), (uint32_t)this->animationStarts_.size(), (uint32_t)this->sheet_->w, (uint32_t)this->sheet_->h };
+    appendBytes(pOut, vCounts, sizeof(vCounts));
+    appendBytes(pOut, this->frames_.data(), this->frames_.size() * sizeof(SDL_Rect));
+    appendBytes(pOut, this->animationStarts_.data(), this->animationStarts_.size() * sizeof(int));
+    for (int vY = 0; vY < this->sheet_->h; vY++)
+        appendBytes(pOut, (const char*)this->sheet_->pixels + vY * this->sheet_->pitch, this->sheet_->w * 4);
 }
 /////////////////////////////////////////////
-void object::setValue(std::string pKey, int pValue)
+size_t spriteAtlas::load(const char* pData, size_t pSize)
 {
-    this->values_[pKey] = pValue;
+    //Frames, animations, width and height, then the frames and the pixels they announce
+    snapshotReader vReader(pData, pSize);
+    uint32_t vCounts[4] = {};
+    vReader.read(vCounts, sizeof(vCounts));
+    if (vReader.failed_ || ((uint64_t)vCounts[0] * 4 + vCounts[1] + (uint64_t)vCounts[2] * vCounts[3]) * 4 > pSize - vReader.position_)
+        return 0;
+    std::vector<SDL_Rect> vFrames(vCounts[0]);
+    std::vector<int> vStarts(vCounts[1]);
+    vReader.read(vFrames.data(), vFrames.size() * sizeof(SDL_Rect));
+    vReader.read(vStarts.data(), vStarts.size() * sizeof(int));
+    for (const SDL_Rect& vFrame : vFrames)
+        if (vFrame.x < 0 || vFrame.y < 0 || vFrame.w < 0 || vFrame.h < 0 || vFrame.x + vFrame.w > (int)vCounts[2] || vFrame.y + vFrame.h > (int)vCounts[3])
+            return 0;
+    for (int vStart : vStarts)
+        if (vStart < 0 || vStart >= (int)vFrames.size())
+            return 0;
+    SDL_Surface* vSheet = SDL_CreateRGBSurfaceWithFormat(0, vCounts[2], vCounts[3], 32, SDL_PIXELFORMAT_ARGB8888);
+    if (vSheet == NULL)
+        return 0;
+    for (int vY = 0; vY < vSheet->h; vY++)
+        vReader.read((char*)vSheet->pixels + vY * vSheet->pitch, vSheet->w * 4);
+    SDL_SetSurfaceBlendMode(vSheet, SDL_BLENDMODE_BLEND);
+    this->sheet_ = vSheet;
+    this->frames_ = vFrames;
+    this->animationStarts_ = vStarts;
+    return vReader.position_;
 }
 /////////////////////////////////////////////
-void object::addPropertie(std::string pPropertie)
+//Path, size and date of every image of an atlas, the cache is stale as soon as one differs
+static std::string getSourceStamp(const std::vector<std::vector<std::string>>& pAnimations)
 {
-    this->properties_.push_back(pPropertie);
+    std::string vStamp;
+    for (const std::vector<std::string>& vAnimation : pAnimations)
+        for (const std::string& vPath : vAnimation)
+        {
+            //-1 for a missing file, the decoding will tell
+#ifdef _WIN32
+            struct _stat64 vStat;
+            bool vFound = (_stat64(vPath.c_str(), &vStat) == 0);
+#else
+            struct stat vStat;
+            bool vFound = (stat(vPath.c_str(), &vStat) == 0);
+#endif
+            long long vSize = (vFound ? (long long)vStat.st_size : -1);
+            long long vDate = (vFound ? (long long)vStat.st_mtime : -1);
+            vStamp += vPath + ":" + std::to_string(vSize) + ":" + std::to_string(vDate) + ";";
+        }
+    return vStamp;
 }
 /////////////////////////////////////////////
-bool object::hasPropertie(std::string pPropertie)
+bool loadAtlasCache(const std::string& pPath, const std::vector<spriteAtlas*>& pAtlases, const std::vector<std::vector<std::vector<std::string>>>& pPaths)
 {
-    return (std::find(this->properties_.begin(), this->properties_.end(), pPropertie) != this->properties_.end());
+    //Mapped, the pixels are copied once into their sheets
+    mappedFile vFile(pPath);
+    if (!vFile.isOpen())
+        return false;
+    snapshotReader vReader(vFile.getData(), vFile.getSize());
+    char vMagic[8] = {};
+    vReader.read(vMagic, sizeof(vMagic));
+    if (memcmp(vMagic, "WSATLAS\0", 8) != 0 || vReader.readInt() != AtlasCacheVersion || vReader.readInt() != pAtlases.size())
+        return false;
+    std::vector<spriteAtlas> vLoaded(pAtlases.size());
+    bool vValid = true;
+    for (int vA = 0; vA < (int)pAtlases.size() && vValid; vA++)
+    {
+        vValid = (vReader.readString() == getSourceStamp(pPaths[vA]) && !vReader.failed_);
+        size_t vRead = (vValid ? vLoaded[vA].load(vReader.data_ + vReader.position_, vReader.size_ - vReader.position_) : 0);
+        vValid = (vRead != 0);
+        vReader.position_ += vRead;
+    }
+    //All or nothing, a stale cache leaves every atlas to decode
+    for (int vA = 0; vA < (int)pAtlases.size(); vA++)
+        if (vValid)
+            *pAtlases[vA] = vLoaded[vA];
+        else
+            SDL_FreeSurface(vLoaded[vA].getSheet());
+    return vValid;
 }
 /////////////////////////////////////////////
-bool object::removePropertie(std::string pPropertie)
+bool saveAtlasCache(const std::string& pPath, const std::vector<spriteAtlas*>& pAtlases, const std::vector<std::vector<std::vector<std::string>>>& pPaths)
 {
-    std::vector<std::string>::iterator itr = std::find(this->properties_.begin(), this->properties_.end(), pPropertie);
-    if (itr != this->properties_.end())
+    std::vector<char> vData;
+    appendBytes(vData, "WSATLAS\0", 8);
+    uint32_t vHeader[2] = { AtlasCacheVersion, (uint32_t)pAtlases.size() };
+    appendBytes(vData, vHeader, sizeof(vHeader));
+    for (int vA = 0; vA < (int)pAtlases.size(); vA++)
     {
-        this->properties_.erase(itr);
-        return true;
+        appendString(vData, getSourceStamp(pPaths[vA]));
+        pAtlases[vA]->save(vData);
     }
-    return false;
+    std::ofstream vFile(pPath, std::ios::binary);
+    return vFile.write(vData.data(), vData.size()) ? true : false;
 }
 //*****************************************************************************
-// ***************************** RENDERED OBJECT ******************************
+// ********************************** REPLAY **********************************
 //*****************************************************************************
-renderedObject::renderedObject(SDL_Surface* image_ptr, SDL_Surface* window_surface_ptr, int width, int height, int x, int y) :
-    object()
+static void appendVarint(std::vector<char>& pOut, uint64_t pValue)
 {
-    this->image_ptr_ = image_ptr;
-    this->window_surface_ptr_ = window_surface_ptr;
-    this->width_ = width;
-    this->height_ = height;
-    this->x_ = x;
-    this->y_ = y;
-}
-int renderedObject::getHeightBox() { return this->height_ * 4 / 5; }
-int renderedObject::getWidthBox() { return this->width_ / 2; }
-int renderedObject::getXBox() { return this->x_ + (this->width_ - this->getWidthBox()) / 2; }
-int renderedObject::getYBox() { return this->y_ + (this->height_ - this->getHeightBox()) / 2; }
-int renderedObject::getX() { return this->x_; }
-int renderedObject::getY() { return this->y_; }
-
+    //Seven bits per byte, the high bit says another byte follows
+    while (pValue >= 0x80)
+    {
+        pOut.push_back((char)(pValue | 0x80));
+        pValue >>= 7;
+    }
+    pOut.push_back((char)pValue);
+}
 /////////////////////////////////////////////
-int renderedObject::getDistance(renderedObject* pO2)
+static bool readVarint(snapshotReader& pReader, uint64_t& pValue)
 {
-    int xDistance = std::min(abs(this->getXBox() - pO2->getXBox()), abs(this->getXBox() - pO2->getXBox() - pO2->getWidthBox()));
-    int yDistance = std::min(abs(this->getYBox() - pO2->getYBox()), abs(this->getYBox() - pO2->getYBox() - pO2->getHeightBox()));
-    return (int)std::sqrt(xDistance * xDistance + yDistance * yDistance);
+    pValue = 0;
+    for (int vShift = 0; vShift < 64; vShift += 7)
+    {
+        uint8_t vByte = 0;
+        if (!pReader.read(&vByte, 1))
+            return false;
+        pValue |= (uint64_t)(vByte & 0x7F) << vShift;
+        if (!(vByte & 0x80))
+            return true;
+    }
+    return false;
 }
 /////////////////////////////////////////////
-bool renderedObject::overlap(renderedObject* vO2)
+replayWriter::replayWriter(const std::string& pPath, const settings& pSettings) :
+    file_(pPath, std::ios::binary)
 {
-    return!((this->getXBox() > vO2->getXBox() + vO2->getWidthBox())
-        || (this->getXBox() + this->getWidthBox() < vO2->getXBox())
-        || (this->getYBox() > vO2->getYBox() + vO2->getHeightBox())
-        || (this->getYBox() + this->getHeightBox() < vO2->getYBox()));
+    this->arrows_ = 0;
+    this->count_ = 0;
+    this->written_ = 0;
+    if (!this->file_)
+        return;
+    //Everything the run is built from, the thread count aside : it changes nothing
+    std::vector<char> vHeader;
+    appendBytes(vHeader, "WSREPLAY", 8);
+    uint32_t vCounts[4] = { ReplayVersion, (uint32_t)pSettings.sheeps_, (uint32_t)pSettings.wolfs_, (uint32_t)pSettings.duration_ };
+    appendBytes(vHeader, vCounts, sizeof(vCounts));
+    appendBytes(vHeader, &pSettings.seed_, sizeof(pSettings.seed_));
+    uint32_t vWorld[2] = { (uint32_t)pSettings.worldWidth_, (uint32_t)pSettings.worldHeight_ };
+    appendBytes(vHeader, vWorld, sizeof(vWorld));
+    appendString(vHeader, pSettings.loadPath_);
+    this->file_.write(vHeader.data(), vHeader.size());
 }
 /////////////////////////////////////////////
-void renderedObject::draw()
+replayWriter::~replayWriter()
 {
-    //La position (et pas la taille) de ce rectangle dfinie l'endroit ou la surface est colle
-    SDL_Rect vRect = { this->x_, this->y_,0, 0 };
-    SDL_BlitSurface(this->image_ptr_, NULL, this->window_surface_ptr_, &vRect);
+    this->close();
 }
-//*****************************************************************************
-// ****************************** MOVING OBJECT *******************************
-//*****************************************************************************
-movingObject::movingObject(int totalVelocity)
+/////////////////////////////////////////////
+void replayWriter::record(int pArrows)
 {
-    this->totalVelocity_ = totalVelocity;
-    this->setRandomVelocitys();
+    if (this->count_ > 0 && pArrows == this->arrows_)
+    {
+        this->count_++;
+        return;
+    }
+    this->flush();
+    this->arrows_ = pArrows;
+    this->count_ = 1;
 }
 /////////////////////////////////////////////
-bool movingObject::canMoveX() { return (this->getXBox() + this->xVelocity_ + this->getWidthBox() < frame_width) && (this->getXBox() + this->xVelocity_ > 0); }
-bool movingObject::canMoveY() { return (this->getYBox() + this->yVelocity_ + this->getHeightBox() < frame_height) && (this->getYBox() + this->yVelocity_ > 0); }
-/////////////////////////////////////////////
-void movingObject::goToward(renderedObject* vMO) { this->goToward(vMO->getXBox(), vMO->getYBox()); }
-void movingObject::goToward(int x, int y)
+void replayWriter::flush()
 {
-    this->xVelocity_ = x - this->getXBox();
-    this->yVelocity_ = y - this->getYBox();
-    this->adjustVelocitys();
+    if (this->count_ == 0)
+        return;
+    std::vector<char> vRun;
+    appendVarint(vRun, this->count_);
+    int32_t vDelta = this->arrows_ - this->written_;
+    appendVarint(vRun, ((uint32_t)vDelta << 1) ^ (uint32_t)(vDelta >> 31));//Zigzag, small changes stay one byte
+    this->file_.write(vRun.data(), vRun.size());
+    this->written_ = this->arrows_;
+    this->count_ = 0;
 }
 /////////////////////////////////////////////
-void movingObject::runAway(renderedObject* vMO) { this->runAway(vMO->getXBox(), vMO->getYBox()); }
-void movingObject::runAway(int x, int y)
+void replayWriter::close()
 {
-    this->xVelocity_ = this->getXBox() - x;
-    this->yVelocity_ = this->getYBox() - y;
-    this->adjustVelocitys();
+    if (!this->file_.is_open())
+        return;
+    this->flush();
+    this->file_.close();
 }
 /////////////////////////////////////////////
-void movingObject::setRandomVelocitys()
+replayReader::replayReader()
 {
-    this->xVelocity_ = (rand() % this->totalVelocity_ * 2) - this->totalVelocity_;
-    if (!canMoveX())
-        this->xVelocity_ = -this->xVelocity_;
-    this->yVelocity_ = (((rand() % 1) * 2) - 1) * (this->totalVelocity_ - abs(this->xVelocity_));
-    if (!canMoveY())
-        this->yVelocity_ = -this->yVelocity_;
+    this->run_ = 0;
+    this->used_ = 0;
+    this->ticks_ = 0;
 }
 /////////////////////////////////////////////
-void movingObject::adjustVelocitys()
+bool replayReader::open(const std::string& pPath, settings& pSettings)
 {
-    //Hors map
-    while (!canMoveX() && this->xVelocity_ != 0)
-        this->xVelocity_ -= (this->xVelocity_ > 0 ? 1 : -1);
-    while (!canMoveY() && this->yVelocity_ != 0)
-        this->yVelocity_ -= (this->yVelocity_ > 0 ? 1 : -1);
-    //Vitesse trop lev
-    while (abs(this->xVelocity_) + abs(this->yVelocity_) > abs(this->totalVelocity_))
+    //Small enough for memory, even for hours : one run per change of keys
+    std::ifstream vFile(pPath, std::ios::binary);
+    std::vector<char> vData((std::istreambuf_iterator<char>(vFile)), std::istreambuf_iterator<char>());
+    snapshotReader vReader(vData.data(), vData.size());
+    char vMagic[8] = {};
+    uint32_t vCounts[4] = {};
+    uint64_t vSeed = 0;
+    uint32_t vWorld[2] = {};
+    vReader.read(vMagic, sizeof(vMagic));
+    vReader.read(vCounts, sizeof(vCounts));
+    vReader.read(&vSeed, sizeof(vSeed));
+    vReader.read(vWorld, sizeof(vWorld));
+    std::string vLoadPath = vReader.readString();
+    if (vReader.failed_ || memcmp(vMagic, "WSREPLAY", 8) != 0 || vCounts[0] != ReplayVersion)
+        return false;
+    pSettings.sheeps_ = vCounts[1];
+    pSettings.wolfs_ = vCounts[2];
+    pSettings.duration_ = vCounts[3];
+    pSettings.seed_ = vSeed;
+    pSettings.worldWidth_ = vWorld[0];
+    pSettings.worldHeight_ = vWorld[1];
+    pSettings.loadPath_ = vLoadPath;
+
+    //A run cut short by the end of the file is dropped
+    this->runs_.clear();
+    this->ticks_ = 0;
+    int vArrows = 0;
+    uint64_t vLength = 0;
+    uint64_t vDelta = 0;
+    while (readVarint(vReader, vLength) && readVarint(vReader, vDelta))
     {
-        this->xVelocity_ -= (this->xVelocity_ > 0 ? 1 : -1);
-        if (abs(this->xVelocity_) + abs(this->yVelocity_) > abs(this->totalVelocity_))
-            this->yVelocity_ -= (this->yVelocity_ > 0 ? 1 : -1);
+        vArrows += (int32_t)((uint32_t)(vDelta >> 1) ^ (0u - (uint32_t)(vDelta & 1)));
+        this->runs_.push_back({ (uint32_t)vLength, vArrows });
+        this->ticks_ += (int)vLength;
     }
-    //Vitesse trop faible
-    if (abs(this->xVelocity_) + abs(this->yVelocity_) < abs(this->totalVelocity_))
-        this->setRandomVelocitys();
+    this->run_ = 0;
+    this->used_ = 0;
+    return true;
 }
 /////////////////////////////////////////////
-void movingObject::move()
+int replayReader::next()
 {
-    if (!canMoveX() || !canMoveY())
-        this->setRandomVelocitys();
-    this->x_ += this->xVelocity_;
-    this->y_ += this->yVelocity_;
+    //Past the log, no keyboard
+    while (this->run_ < (int)this->runs_.size() && this->used_ == this->runs_[this->run_].first)
+    {
+        this->run_++;
+        this->used_ = 0;
+    }
+    if (this->run_ == (int)this->runs_.size())
+        return -1;
+    this->used_++;
+    return this->runs_[this->run_].second;
 }
 //*****************************************************************************
-// ***************************** ANIMATED OBJECT ******************************
+// ********************************** EXPORT **********************************
 //*****************************************************************************
-animatedObject::animatedObject(int frameInterval)
+static bool endsWith(const std::string& pText, const char* pEnd)
 {
-    
-    this->frameInterval_ = frameInterval;
-    this->frameDuration_ = frameInterval;
-    this->frameIndex_ = 0;
+    size_t vLength = strlen(pEnd);
+    return pText.size() >= vLength && pText.compare(pText.size() - vLength, vLength, pEnd) == 0;
+}
+/////////////////////////////////////////////
+frameExporter::frameExporter(const std::string& pPath, int pWidth, int pHeight, int pWorkers)
+{
+    this->path_ = pPath;
+    this->width_ = pWidth;
+    this->height_ = pHeight;
+    this->submitted_ = 0;
+    this->written_ = 0;
+    this->closing_ = false;
+    this->failed_ = false;
+    if (endsWith(pPath, ".png"))
+        this->encoding_ = encoding::png;
+    else if (endsWith(pPath, ".qoi"))
+        this->encoding_ = encoding::qoi;
+    else if (endsWith(pPath, ".y4m"))
+        this->encoding_ = encoding::y4m;
+    else
+        return;
+    if (this->encoding_ == encoding::y4m)
+    {
+        this->stream_.open(pPath, std::ios::binary);
+        if (!this->stream_)
+            return;
+        //The samples are full range, readers assume limited range without the tag
+        this->stream_ << "YUV4MPEG2 W" << pWidth << " H" << pHeight << " F" << FPS << ":1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n";
+    }
+    //One frame drawn while one waits and each worker encodes its own, beyond that the simulation waits
+    for (int vF = 0; vF < pWorkers + 2; vF++)
+    {
+        SDL_Surface* vFrame = SDL_CreateRGBSurfaceWithFormat(0, pWidth, pHeight, 32, SDL_PIXELFORMAT_RGB888);
+        if (vFrame == NULL)
+            break;
+        this->frames_.push_back(vFrame);
+    }
+    this->free_ = this->frames_;
+    this->scratch_.resize(pWorkers);
+    for (int vW = 0; vW < pWorkers; vW++)
+        this->workers_.push_back(std::thread(&frameExporter::work, this, vW));
 }
 /////////////////////////////////////////////
-void animatedObject::updateFrameDuration()
+frameExporter::~frameExporter()
 {
-    this->frameDuration_++;
-    if (this->frameDuration_ >= this->frameInterval_)
-        this->nextFrame();
+    this->close();
 }
 /////////////////////////////////////////////
-void animatedObject::nextFrame()
+SDL_Surface* frameExporter::acquire()
 {
-    this->frameIndex_++;
-    std::string imageKey = this->getImageKey();
-    if (this->frameIndex_ >= this->images_.at(imageKey).size())
-        this->frameIndex_ = 0;
-    this->image_ptr_ = this->images_.at(imageKey)[this->frameIndex_];
-    this->frameDuration_ = 0;
+    std::unique_lock<std::mutex> vLock(this->mutex_);
+    this->changed_.wait(vLock, [this]() { return !this->free_.empty(); });
+    SDL_Surface* vFrame = this->free_.back();
+    this->free_.pop_back();
+    return vFrame;
 }
 /////////////////////////////////////////////
-std::map<std::string, std::vector<SDL_Surface*>>
-animatedObject::createSurfaceMap(std::map<std::string, std::vector<std::string>> pPathMap)
+void frameExporter::submit(SDL_Surface* pFrame)
 {
-    std::map<std::string, std::vector<SDL_Surface*>> surfaceMap;
-    std::map<std::string, std::vector<std::string>>::iterator it;
-    for (it = pPathMap.begin(); it != pPathMap.end(); it++)
+    //The surface itself goes to the worker, it is drawn again only once encoded
     {
-        std::string vKey = it->first;
-        std::vector<std::string> vPaths = it->second;
-        std::vector<SDL_Surface*> vSurfaces = {};
-        for (std::string vPath : vPaths)
-            vSurfaces.push_back(IMG_Load(vPath.c_str()));
-        surfaceMap.insert({ vKey,vSurfaces });
+        std::lock_guard<std::mutex> vLock(this->mutex_);
+        this->pending_.push_back({ pFrame, this->submitted_++ });
     }
-    return surfaceMap;
+    this->changed_.notify_all();
+}
+/////////////////////////////////////////////
+bool frameExporter::close()
+{
+    {
+        std::lock_guard<std::mutex> vLock(this->mutex_);
+        this->closing_ = true;
+    }
+    this->changed_.notify_all();
+    for (std::thread& vWorker : this->workers_)
+        vWorker.join();
+    this->workers_.clear();
+    if (this->stream_.is_open())
+    {
+        this->stream_.close();
+        this->failed_ = this->failed_ || this->stream_.fail();
+    }
+    for (SDL_Surface* vFrame : this->frames_)
+        SDL_FreeSurface(vFrame);
+    this->frames_.clear();
+    this->free_.clear();
+    return !this->failed_;
+}
+/////////////////////////////////////////////
+void frameExporter::work(int pWorker)
+{
+    while (true)
+    {
+        std::pair<SDL_Surface*, int> vFrame;
+        {
+            std::unique_lock<std::mutex> vLock(this->mutex_);
+            this->changed_.wait(vLock, [this]() { return this->closing_ || !this->pending_.empty(); });
+            if (this->pending_.empty())
+                return;
+            vFrame = this->pending_.front();
+            this->pending_.pop_front();
+        }
+        bool vWritten = this->encode(vFrame.first, vFrame.second, this->scratch_[pWorker]);
+        {
+            std::lock_guard<std::mutex> vLock(this->mutex_);
+            this->failed_ = this->failed_ || !vWritten;
+            this->free_.push_back(vFrame.first);
+        }
+        this->changed_.notify_all();
+    }
+}
+/////////////////////////////////////////////
+bool frameExporter::encode(SDL_Surface* pFrame, int pNumber, std::vector<char>& pScratch)
+{
+    if (this->encoding_ == encoding::y4m)
+    {
+        //Converted in parallel, written in order
+        this->encodeYuv(pFrame, pScratch);
+        std::unique_lock<std::mutex> vLock(this->mutex_);
+        this->changed_.wait(vLock, [this, pNumber]() { return this->written_ == pNumber; });
+        this->stream_.write("FRAME\n", 6);
+        this->stream_.write(pScratch.data(), pScratch.size());
+        this->written_++;
+        vLock.unlock();
+        this->changed_.notify_all();
+        return true;
+    }
+    //run.png gives run000000.png, run000001.png...
+    char vNumber[16];
+    snprintf(vNumber, sizeof(vNumber), "%06d", pNumber);
+    std::string vPath = this->path_;
+    vPath.insert(vPath.size() - 4, vNumber);
+    if (this->encoding_ == encoding::png)
+        return IMG_SavePNG(pFrame, vPath.c_str()) == 0;
+    this->encodeQoi(pFrame, pScratch);
+    std::ofstream vFile(vPath, std::ios::binary);
+    return vFile.write(pScratch.data(), pScratch.size()) ? true : false;
+}
+/////////////////////////////////////////////
+void frameExporter::encodeQoi(SDL_Surface* pFrame, std::vector<char>& pOut)
+{
+    //The Quite OK Image format, opaque RGB : a run, an index into the recent colors, a small difference or the color
+    pOut.clear();
+    appendBytes(pOut, "qoif", 4);
+    for (uint32_t vSide : { (uint32_t)pFrame->w, (uint32_t)pFrame->h })
+        for (int vShift = 24; vShift >= 0; vShift -= 8)
+            pOut.push_back((char)(vSide >> vShift));
+    pOut.push_back(3);
+    pOut.push_back(0);
+    uint32_t vIndex[64] = {};
+    uint32_t vPrevious = 0;
+    int vRun = 0;
+    int vLast = pFrame->w * pFrame->h - 1;
+    for (int vY = 0; vY < pFrame->h; vY++)
+    {
+        const uint32_t* vRow = (const uint32_t*)((const char*)pFrame->pixels + vY * pFrame->pitch);
+        for (int vX = 0; vX < pFrame->w; vX++)
+        {
+            uint32_t vPixel = vRow[vX] & 0xFFFFFF;
+            int vR = vPixel >> 16;
+            int vG = (vPixel >> 8) & 0xFF;
+            int vB = vPixel & 0xFF;
+            if (vPixel == vPrevious)
+            {
+                if (++vRun == 62 || vY * pFrame->w + vX == vLast)
+                {
+                    pOut.push_back((char)(0xC0 | (vRun - 1)));
+                    vRun = 0;
+                }
+                continue;
+            }
+            if (vRun > 0)
+            {
+                pOut.push_back((char)(0xC0 | (vRun - 1)));
+                vRun = 0;
+            }
+            int vHash = (vR * 3 + vG * 5 + vB * 7 + 255 * 11) % 64;
+            if (vIndex[vHash] == (vPixel | 0xFF000000))
+                pOut.push_back((char)vHash);
+            else
+            {
+                vIndex[vHash] = vPixel | 0xFF000000;
+                //Differences wrap around like the bytes
+                int vDr = (int8_t)(vR - (int)(vPrevious >> 16));
+                int vDg = (int8_t)(vG - (int)((vPrevious >> 8) & 0xFF));
+                int vDb = (int8_t)(vB - (int)(vPrevious & 0xFF));
+                if (vDr >= -2 && vDr <= 1 && vDg >= -2 && vDg <= 1 && vDb >= -2 && vDb <= 1)
+                    pOut.push_back((char)(0x40 | (vDr + 2) << 4 | (vDg + 2) << 2 | (vDb + 2)));
+                else if (vDg >= -32 && vDg <= 31 && vDr - vDg >= -8 && vDr - vDg <= 7 && vDb - vDg >= -8 && vDb - vDg <= 7)
+                {
+                    pOut.push_back((char)(0x80 | (vDg + 32)));
+                    pOut.push_back((char)((vDr - vDg + 8) << 4 | (vDb - vDg + 8)));
+                }
+                else
+                {
+                    const char vColor[4] = { (char)0xFE, (char)vR, (char)vG, (char)vB };
+                    appendBytes(pOut, vColor, 4);
+                }
+            }
+            vPrevious = vPixel;
+        }
+    }
+    const char End[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    appendBytes(pOut, End, 8);
+}
+/////////////////////////////////////////////
+void frameExporter::encodeYuv(SDL_Surface* pFrame, std::vector<char>& pOut)
+{
+    //Full range BT.601 luma, then chroma from the average of each 2x2 block
+    int vChromaWidth = (pFrame->w + 1) / 2;
+    int vChromaHeight = (pFrame->h + 1) / 2;
+    int vLumaSize = pFrame->w * pFrame->h;
+    int vChromaSize = vChromaWidth * vChromaHeight;
+    pOut.resize(vLumaSize + 2 * vChromaSize);
+    uint8_t* vLuma = (uint8_t*)pOut.data();
+    uint8_t* vBlue = vLuma + vLumaSize;
+    uint8_t* vRed = vBlue + vChromaSize;
+    for (int vY = 0; vY < pFrame->h; vY++)
+    {
+        const uint32_t* vRow = (const uint32_t*)((const char*)pFrame->pixels + vY * pFrame->pitch);
+        for (int vX = 0; vX < pFrame->w; vX++)
+        {
+            uint32_t vPixel = vRow[vX];
+            vLuma[vY * pFrame->w + vX] = (uint8_t)((77 * (int)(vPixel >> 16 & 0xFF) + 150 * (int)(vPixel >> 8 & 0xFF) + 29 * (int)(vPixel & 0xFF) + 128) >> 8);
+        }
+    }
+    for (int vY = 0; vY < vChromaHeight; vY++)
+        for (int vX = 0; vX < vChromaWidth; vX++)
+        {
+            int vSums[3] = { 0, 0, 0 };
+            int vCount = 0;
+            for (int vRow = 2 * vY; vRow < std::min(2 * vY + 2, pFrame->h); vRow++)
+                for (int vColumn = 2 * vX; vColumn < std::min(2 * vX + 2, pFrame->w); vColumn++)
+                {
+                    uint32_t vPixel = ((const uint32_t*)((const char*)pFrame->pixels + vRow * pFrame->pitch))[vColumn];
+                    vSums[0] += vPixel >> 16 & 0xFF;
+                    vSums[1] += vPixel >> 8 & 0xFF;
+                    vSums[2] += vPixel & 0xFF;
+                    vCount++;
+                }
+            int vR = vSums[0] / vCount;
+            int vG = vSums[1] / vCount;
+            int vB = vSums[2] / vCount;
+            vBlue[vY * vChromaWidth + vX] = (uint8_t)std::min(std::max(((-43 * vR - 85 * vG + 128 * vB + 128) >> 8) + 128, 0), 255);
+            vRed[vY * vChromaWidth + vX] = (uint8_t)std::min(std::max(((128 * vR - 107 * vG - 21 * vB + 128) >> 8) + 128, 0), 255);
+        }
 }
 //*****************************************************************************
-// ********************************* SHEPERD **********************************
-//*****************************************************************************
-SDL_Surface* shepherd::ShepherdImage  = IMG_Load("media/shepherd.png");
-int shepherd::ImgW = 49;
-int shepherd::ImgH = 49;
+// ********************************** CAMERA **********************************
 //*****************************************************************************
-shepherd::shepherd(SDL_Surface* window_surface_ptr) :
-    renderedObject(ShepherdImage, window_surface_ptr, shepherd::ImgW, shepherd::ImgH, frame_width / 2, frame_height / 2), movingObject(4)
+camera::camera(int pWorldWidth, int pWorldHeight)
 {
-    this->properties_ = {"shepherd"};
+    this->x_ = 0;
+    this->y_ = 0;
+    this->zoom_ = 1;
+    this->worldWidth_ = pWorldWidth;
+    this->worldHeight_ = pWorldHeight;
+    this->clamp();
 }
 /////////////////////////////////////////////
-void shepherd::update()
+void camera::clamp()
 {
-    this->move();
-    this->draw();
+    //The view stays inside the world, centered when the world is smaller
+    float vViewWidth = frame_width / this->zoom_;
+    float vViewHeight = frame_height / this->zoom_;
+    if (vViewWidth >= this->worldWidth_)
+        this->x_ = (this->worldWidth_ - vViewWidth) / 2;
+    else
+        this->x_ = std::min(std::max(this->x_, 0.0f), this->worldWidth_ - vViewWidth);
+    if (vViewHeight >= this->worldHeight_)
+        this->y_ = (this->worldHeight_ - vViewHeight) / 2;
+    else
+        this->y_ = std::min(std::max(this->y_, 0.0f), this->worldHeight_ - vViewHeight);
 }
 /////////////////////////////////////////////
-void shepherd::interact(renderedObject* pO2)
-{}
+void camera::centerOn(float x, float y)
+{
+    this->x_ = x - frame_width / 2 / this->zoom_;
+    this->y_ = y - frame_height / 2 / this->zoom_;
+    this->clamp();
+}
 /////////////////////////////////////////////
-void shepherd::move()
+void camera::scroll(float pDx, float pDy)
 {
-    const uint8_t* keystate = SDL_GetKeyboardState(0);
-    //Horizontal Velocity
-    if (keystate[SDL_SCANCODE_LEFT])  
-        this->xVelocity_ = -this->totalVelocity_; 
-    else if (keystate[SDL_SCANCODE_RIGHT]) 
-        this->xVelocity_ = this->totalVelocity_; 
-    else 
-        this->xVelocity_ = 0; 
-    //Vertical Velocity
-    if (keystate[SDL_SCANCODE_UP])  
-        this->yVelocity_ = -this->totalVelocity_; 
-    else if (keystate[SDL_SCANCODE_DOWN]) 
-        this->yVelocity_ = this->totalVelocity_; 
-    else 
-        this->yVelocity_ = 0; 
-    //Move
-    if (canMoveX())
-        this->x_ += this->xVelocity_;
-    if (canMoveY())
-        this->y_ += this->yVelocity_;
+    this->x_ += pDx / this->zoom_;
+    this->y_ += pDy / this->zoom_;
+    this->clamp();
+}
+/////////////////////////////////////////////
+void camera::zoom(float pFactor)
+{
+    const float MaxZoom = 4;
+    float vCenterX = this->x_ + frame_width / 2 / this->zoom_;
+    float vCenterY = this->y_ + frame_height / 2 / this->zoom_;
+    this->zoom_ = std::min(std::max(this->zoom_ * pFactor, this->getMinZoom()), MaxZoom);
+    this->centerOn(vCenterX, vCenterY);
+}
+/////////////////////////////////////////////
+float camera::getMinZoom()
+{
+    return std::min(1.0f, std::min((float)frame_width / this->worldWidth_, (float)frame_height / this->worldHeight_));
+}
+/////////////////////////////////////////////
+SDL_Rect camera::toScreen(int x, int y, int w, int h)
+{
+    //Both corners are rounded the same way, so neighbours stay joined at any zoom
+    int vLeft = (int)std::floor((x - this->x_) * this->zoom_);
+    int vTop = (int)std::floor((y - this->y_) * this->zoom_);
+    int vRight = (int)std::floor((x + w - this->x_) * this->zoom_);
+    int vBottom = (int)std::floor((y + h - this->y_) * this->zoom_);
+    return { vLeft, vTop, vRight - vLeft, vBottom - vTop };
+}
+/////////////////////////////////////////////
+bool camera::isVisible(const SDL_Rect& pScreenRect)
+{
+    return pScreenRect.w > 0 && pScreenRect.h > 0 && pScreenRect.x < frame_width && pScreenRect.y < frame_height
+        && pScreenRect.x + pScreenRect.w > 0 && pScreenRect.y + pScreenRect.h > 0;
 }
 //*****************************************************************************
-//*********************************** WOLF ************************************
-//*****************************************************************************
-std::map<std::string, std::vector<SDL_Surface*>> wolf::WolfImages = wolf::createSurfaceMap(wolf::createPathMap());
-SDL_Surface* wolf::WolfImage = IMG_Load("media/wolf.png");
-int wolf::ImgW = 157;
-int wolf::ImgH = 110;
+// ******************************* TIMING WHEEL *******************************
 //*****************************************************************************
-wolf::wolf(SDL_Surface* window_surface_ptr, int x, int y) :
-    renderedObject(WolfImage, window_surface_ptr, wolf::ImgW, wolf::ImgH, x, y), animatedObject(4), movingObject(4)
+void timingWheel::schedule(int pTick, int pIndex)
 {
-    this->images_ = WolfImages;
-    this->values_.insert({ "preyDistance", -1 });
-    this->values_.insert({ "timeBeforeStarve", 400 });
-    this->properties_ = { "wolf" };
+    //Grows with the herd only
+    if (pIndex >= (int)this->slots_.size())
+    {
+        this->next_.resize(pIndex + 1, -1);
+        this->previous_.resize(pIndex + 1, -1);
+        this->slots_.resize(pIndex + 1, -1);
+    }
+    int vSlot = pTick % Size;
+    this->slots_[pIndex] = vSlot;
+    this->previous_[pIndex] = -1;
+    this->next_[pIndex] = this->heads_[vSlot];
+    if (this->heads_[vSlot] != -1)
+        this->previous_[this->heads_[vSlot]] = pIndex;
+    this->heads_[vSlot] = pIndex;
 }
 /////////////////////////////////////////////
-wolf::wolf(SDL_Surface* window_surface_ptr) :
-    wolf::wolf(window_surface_ptr, (rand() % (frame_width - wolf::ImgW)), (rand() % (frame_height - wolf::ImgH))){}
-/////////////////////////////////////////////
-void wolf::update()
+void timingWheel::remove(int pIndex)
 {
-    this->move();
-    this->updateFrameDuration();
-    this->draw();
-    this->updateTimeBeforeStarve();
-    this->values_["preyDistance"]=-1;
-    this->removePropertie("scared");
+    if (pIndex >= (int)this->slots_.size() || this->slots_[pIndex] == -1)
+        return;
+    if (this->previous_[pIndex] != -1)
+        this->next_[this->previous_[pIndex]] = this->next_[pIndex];
+    else
+        this->heads_[this->slots_[pIndex]] = this->next_[pIndex];
+    if (this->next_[pIndex] != -1)
+        this->previous_[this->next_[pIndex]] = this->previous_[pIndex];
+    this->slots_[pIndex] = -1;
 }
 /////////////////////////////////////////////
-void wolf::interact(renderedObject* pO2)
+void timingWheel::move(int pFrom, int pTo)
 {
-    if (pO2->hasPropertie("shepherd") && this->getDistance(pO2) < 150)
+    if (pFrom >= (int)this->slots_.size() || this->slots_[pFrom] == -1)
     {
-        this->addPropertie("scared");
-        this->runAway(pO2);
+        if (pTo < (int)this->slots_.size())
+            this->slots_[pTo] = -1;
+        return;
     }
-    else if (this->overlap(pO2) && pO2->hasPropertie("prey"))
+    //Its neighbours point to the new index
+    this->slots_[pTo] = this->slots_[pFrom];
+    this->next_[pTo] = this->next_[pFrom];
+    this->previous_[pTo] = this->previous_[pFrom];
+    if (this->previous_[pTo] != -1)
+        this->next_[this->previous_[pTo]] = pTo;
+    else
+        this->heads_[this->slots_[pTo]] = pTo;
+    if (this->next_[pTo] != -1)
+        this->previous_[this->next_[pTo]] = pTo;
+    this->slots_[pFrom] = -1;
+}
+/////////////////////////////////////////////
+void timingWheel::reserve(int pCount)
+{
+    this->next_.reserve(pCount);
+    this->previous_.reserve(pCount);
+    this->slots_.reserve(pCount);
+}
+/////////////////////////////////////////////
+void timingWheel::clear()
+{
+    std::fill(this->heads_.begin(), this->heads_.end(), -1);
+    std::fill(this->slots_.begin(), this->slots_.end(), -1);
+}
+//*****************************************************************************
+// ********************************** VIEWS ***********************************
+//*****************************************************************************
+bool viewBuffer::acquire()
+{
+    if (!(this->published_.load(std::memory_order_acquire) & Fresh))
+        return false;
+    this->reading_ = this->published_.exchange(this->reading_, std::memory_order_acq_rel) & ~Fresh;
+    return true;
+}
+//*****************************************************************************
+// ********************************** GROUND **********************************
+//*****************************************************************************
+ground::ground(SDL_Surface* window_surface_ptr, int pThreadCount, uint64_t pSeed) :
+    camera_(frame_width, frame_height),
+    shepherds_(shepherd::createHerd()), wolfs_(wolf::createHerd()), sheeps_(sheep::createHerd()), pool_(pThreadCount)
+{
+    this->window_surface_ptr_ = window_surface_ptr;
+    this->renderer_ = NULL;
+    this->shepherds_.seed_ = pSeed;
+    this->wolfs_.seed_ = pSeed;
+    this->sheeps_.seed_ = pSeed;
+    this->wolfs_.wheel_ = &this->starvations_;
+    this->buffers_.resize(this->pool_.getThreadCount());
+    this->overlay_ = false;
+    this->arrows_ = -1;
+    this->arrowsRead_ = -1;
+    this->tick_ = 0;
+    this->lambSerial_ = 0;
+    //Everything is damaged before the first render
+    this->damagedTiles_.assign(TileColumns * TileRows, 1);
+    this->background_ = NULL;
+    if (this->window_surface_ptr_ != NULL)
     {
-        this->setValue("timeBeforeStarve", 400);
-        pO2->addPropertie("dead");
+        this->background_ = SDL_CreateRGBSurfaceWithFormat(0, frame_width, frame_height,
+            this->window_surface_ptr_->format->BitsPerPixel, this->window_surface_ptr_->format->format);
+        this->drawGround();
     }
-    else if (!this->hasPropertie("scared") && pO2->hasPropertie("prey"))
+}
+/////////////////////////////////////////////
+void ground::setWorld(int pWidth, int pHeight)
+{
+    for (herd* vHerd : { &this->shepherds_, &this->wolfs_, &this->sheeps_ })
     {
-        int distance = this->getDistance(pO2);
-        if (this->values_["preyDistance"] == -1 || this->values_["preyDistance"] > distance)
-        {
-            this->values_["preyDistance"] = distance;
-            this->goToward(pO2);
-        }
+        vHerd->worldWidth_ = pWidth;
+        vHerd->worldHeight_ = pHeight;
     }
+    //Starts on the shepherd
+    this->camera_ = camera(pWidth, pHeight);
+    this->camera_.centerOn(pWidth / 2.0f, pHeight / 2.0f);
+}
+/////////////////////////////////////////////
+void ground::addShepherd()
+{
+    shepherd::add(this->shepherds_);
+    this->lambSerial_ = this->sheeps_.nextSerial_;
+}
+void ground::addWolf()
+{
+    int vIndex = wolf::add(this->wolfs_);
+    this->lambSerial_ = this->sheeps_.nextSerial_;
+    this->starvations_.schedule(this->wolfs_.getValue(vIndex, field::starveTick), vIndex);
+}
+void ground::addSheep() { sheep::add(this->sheeps_); }
+/////////////////////////////////////////////
+void ground::reserve(int pSheeps, int pWolfs)
+{
+    this->shepherds_.reserve(1);
+    this->wolfs_.reserve(pWolfs);
+    this->sheeps_.reserve(pSheeps);
+    this->commands_.reserve(pSheeps + pWolfs + 1);
+    this->grid_.reserve(pSheeps);
+    this->wolfGrid_.reserve(pWolfs);
+    this->starvations_.reserve(pWolfs);
+    for (commandBuffer& vBuffer : this->buffers_)
+        vBuffer.reserve(pSheeps);
+    this->chunks_.reserve(std::max(pSheeps / SheepChunk, pWolfs / WolfChunk) + 1);
 }
+shepherd ground::getShepherd(int pIndex) { return shepherd(&this->shepherds_, pIndex); }
+wolf ground::getWolf(int pIndex) { return wolf(&this->wolfs_, pIndex); }
+sheep ground::getSheep(int pIndex) { return sheep(&this->sheeps_, pIndex); }
 /////////////////////////////////////////////
-void wolf::updateTimeBeforeStarve()
+void ground::update()
 {
-    this->values_["timeBeforeStarve"]--;  
-    if (this->values_["timeBeforeStarve"] <= 0)
-        this->addPropertie("dead");
+    this->simulate();
+    this->publish(this->view_);
+    this->render(this->view_, 1);
 }
 /////////////////////////////////////////////
-std::map<std::string, std::vector<std::string>> wolf::createPathMap()
+void ground::simulate()
 {
-    std::string p = "media/wolfs/";
-    std::vector<std::string> vPNW, vPNE, vPSW, vPSE;
-    for (int i = 1; i <= 12; i++)
+    this->shepherds_.savePositions();
+    this->wolfs_.savePositions();
+    this->sheeps_.savePositions();
+    this->telemetry_ = telemetryRecord();
+    this->telemetry_.tick_ = this->tick_;
+    {
+        scopedTimer vTimer(this->profiler_, phase::interact);
+        this->makeInteract();
+    }
+    {
+        scopedTimer vTimer(this->profiler_, phase::update);
+        this->updateObjects();
+    }
+    {
+        scopedTimer vTimer(this->profiler_, phase::removeDeads);
+        this->removeDeads();
+    }
     {
-        vPNW.push_back(p + "nw (" + std::to_string(i) + ").png");
-        vPNE.push_back(p + "ne (" + std::to_string(i) + ").png");
-        vPSW.push_back(p + "sw (" + std::to_string(i) + ").png");
-        vPSE.push_back(p + "se (" + std::to_string(i) + ").png");
+        scopedTimer vTimer(this->profiler_, phase::addNews);
+        this->addNews();
     }
-    std::map<std::string, std::vector<std::string>> pathMap = { {"nw",vPNW},{"ne",vPNE},{"sw",vPSW},{"se",vPSE} };
-    return pathMap;
+    this->profiler_.endTick(this->sheeps_.size(), this->wolfs_.size());
+    this->telemetry_.sheeps_ = this->sheeps_.size();
+    this->telemetry_.wolfs_ = this->wolfs_.size();
+    this->tick_++;
+    for (herd* vHerd : { &this->shepherds_, &this->wolfs_, &this->sheeps_ })
+        vHerd->now_ = this->tick_;
 }
 /////////////////////////////////////////////
-std::string wolf::getImageKey()
+void ground::publish(worldView& pView)
 {
-    if (this->xVelocity_ <= 0 && this->yVelocity_ >= 0) { return "sw"; }
-    if (this->xVelocity_ >= 0 && this->yVelocity_ >= 0) { return "se"; }
-    if (this->xVelocity_ <= 0 && this->yVelocity_ <= 0) { return "nw"; }
-    return "ne";
+    this->publishHerd(this->shepherds_, shepherd::getFrame, pView.getHerd(species::shepherd));
+    this->publishHerd(this->wolfs_, wolf::getFrame, pView.getHerd(species::wolf));
+    this->publishHerd(this->sheeps_, sheep::getFrame, pView.getHerd(species::sheep));
+    pView.profile_ = this->profiler_.getLast();
 }
-//*****************************************************************************
-//*********************************** SHEEP ***********************************
-//*****************************************************************************
-std::map<std::string, std::vector<SDL_Surface*>> sheep::SheepImagesM = sheep::createSurfaceMap(sheep::createPathMap("male"));
-std::map<std::string, std::vector<SDL_Surface*>> sheep::SheepImagesF = sheep::createSurfaceMap(sheep::createPathMap("female"));
-SDL_Surface* sheep::SheepImage = IMG_Load("media/sheep.png");
-int sheep::ImgW = 68;
-int sheep::ImgH = 60;
-//*****************************************************************************
-sheep::sheep(SDL_Surface* window_surface_ptr, int x, int y) :
-    renderedObject(SheepImage, window_surface_ptr, sheep::ImgW, sheep::ImgH, x, y), animatedObject(10), movingObject(3)
+/////////////////////////////////////////////
+void ground::publishHerd(herd& pHerd, const SDL_Rect& (*pGetFrame)(herd&, int), herdView& pView)
 {
-    this->values_.insert({"timeBeforeProcreate" , 0});
-    this->properties_ = {"sheep", "prey", "canprocreate", (rand() % 2 ? "male" : "female") };
-    this->images_ = (this->hasPropertie("female") ? SheepImagesF : SheepImagesM);
+    //The views are reused, nothing is allocated once they are big enough
+    pView.prevX_ = pHerd.prevX_;
+    pView.prevY_ = pHerd.prevY_;
+    pView.x_ = pHerd.x_;
+    pView.y_ = pHerd.y_;
+    pView.serials_ = pHerd.serial_;
+    pView.frames_.resize(pHerd.size());
+    for (int vI = 0; vI < pHerd.size(); vI++)
+        pView.frames_[vI] = &pGetFrame(pHerd, vI);
 }
 /////////////////////////////////////////////
-sheep::sheep(SDL_Surface* window_surface_ptr) :
-    sheep(window_surface_ptr, (rand() % (frame_width - sheep::ImgW)), (rand() % (frame_height - sheep::ImgH)))
-{}
+void ground::setTarget(SDL_Surface* pSurface)
+{
+    //Nothing of what was drawn before is on it
+    this->window_surface_ptr_ = pSurface;
+    this->damagedTiles_.assign(TileColumns * TileRows, 1);
+}
 /////////////////////////////////////////////
-void sheep::update()
+void ground::setArrows(const uint8_t* pKeys)
 {
-    this->move();
-    this->updateFrameDuration();
-    this->draw();
-    this->values_["timeBeforeProcreate"]--;
+    int vArrows = 0;
+    for (int vA = 0; vA < 4; vA++)
+        vArrows |= (pKeys[SDL_SCANCODE_RIGHT + vA] ? 1 : 0) << vA;
+    this->arrows_.store(vArrows, std::memory_order_relaxed);
 }
 /////////////////////////////////////////////
-void sheep::interact(renderedObject* pO2)
+void ground::render(worldView& pView, float pAlpha)
 {
-    //Run away a wolf
-    if (pO2->hasPropertie("wolf") && this->getDistance(pO2) < 200)
-        this->runAway(pO2);
-    //Reproduce
-    else if (this->hasPropertie("male") && pO2->hasPropertie("female") && this->overlap(pO2)
-         && this->getValue("timeBeforeProcreate") <= 0 && pO2->getValue("timeBeforeProcreate") <= 0)
+    if (this->renderer_ != NULL)
+        return this->renderBatches(pView, pAlpha);
+    if (this->window_surface_ptr_ == NULL)
+        return;
+    //The ground is the same under any camera, so a scroll or a zoom only damages the old and new places of the agents.
+    //They all move on screen then, nothing more than them is redrawn
+    if (this->overlay_)
+    {
+        //Drawn over everything, so always redrawn
+        SDL_Rect vOverlay = { 0, 0, frame_width, 8 + (int)phase::count * 8 };
+        this->damage(vOverlay);
+    }
     {
-        this->setValue("timeBeforeProcreate", 500);
-        pO2->setValue("timeBeforeProcreate", 500);
-        pO2->addPropertie("pregnant");
+        //Agents that moved or changed frame damage their old and new places
+        scopedTimer vTimer(this->profiler_, phase::drawAgents);
+        this->commands_.clear();
+        this->queueHerd(pView.getHerd(species::sheep), sheep::getAtlas(), this->drawn_[(int)species::sheep], pAlpha);
+        this->queueHerd(pView.getHerd(species::wolf), wolf::getAtlas(), this->drawn_[(int)species::wolf], pAlpha);
+        this->queueHerd(pView.getHerd(species::shepherd), shepherd::getAtlas(), this->drawn_[(int)species::shepherd], pAlpha);
+        this->buildDamage();
     }
+    {
+        scopedTimer vTimer(this->profiler_, phase::drawGround);
+        for (SDL_Rect vRun : this->damage_)
+            SDL_BlitSurface(this->background_, &vRun, this->window_surface_ptr_, &vRun);
+    }
+    {
+        //Each agent is redrawn only inside the damaged runs, in the same order as before
+        scopedTimer vTimer(this->profiler_, phase::drawAgents);
+        for (const drawCommand& vCommand : this->commands_)
+        {
+            int vFirstRow = std::max(vCommand.target_.y / TileSize, 0);
+            int vLastRow = std::min((vCommand.target_.y + vCommand.target_.h - 1) / TileSize, TileRows - 1);
+            for (int vRow = vFirstRow; vRow <= vLastRow; vRow++)
+                for (int vR = this->rowStarts_[vRow]; vR < this->rowStarts_[vRow + 1]; vR++)
+                    this->drawImage(vCommand, this->damage_[vR]);
+        }
+    }
+    if (this->overlay_)
+        this->drawProfile(pView.profile_);
 }
 /////////////////////////////////////////////
-std::map<std::string, std::vector<std::string>> sheep::createPathMap(std::string pGender)
+void ground::renderBatches(worldView& pView, float pAlpha)
 {
-    std::string p = (pGender == "female" ? "media/sheepsF/" : "media/sheepsM/");
-    std::vector<std::string> vPNW, vPNE, vPSW, vPSE;
-    for (int i = 1; i <= 10; i++)
+    //The GPU redraws the whole frame, there is nothing to gain from damage tracking
+    {
+        scopedTimer vTimer(this->profiler_, phase::drawGround);
+        SDL_SetRenderDrawColor(this->renderer_, 0x04, 0xA8, 0x8D, 0xFF);
+        SDL_RenderClear(this->renderer_);
+    }
     {
-        vPNW.push_back(p + "nw (" + std::to_string(i) + ").png");
-        vPNE.push_back(p + "ne (" + std::to_string(i) + ").png");
-        vPSW.push_back(p + "sw (" + std::to_string(i) + ").png");
-        vPSE.push_back(p + "se (" + std::to_string(i) + ").png");
+        //One batch per texture, in the same order as the blits
+        scopedTimer vTimer(this->profiler_, phase::drawAgents);
+        this->drawBatch(pView.getHerd(species::sheep), sheep::getAtlas(), pAlpha);
+        this->drawBatch(pView.getHerd(species::wolf), wolf::getAtlas(), pAlpha);
+        this->drawBatch(pView.getHerd(species::shepherd), shepherd::getAtlas(), pAlpha);
     }
-    std::map<std::string, std::vector<std::string>> pathMap = { {"nw",vPNW},{"ne",vPNE},{"sw",vPSW},{"se",vPSE} };
-    return pathMap;
+    if (this->overlay_)
+        this->drawProfile(pView.profile_);
 }
 /////////////////////////////////////////////
-std::string sheep::getImageKey()
+void ground::drawBatch(herdView& pView, spriteAtlas& pAtlas, float pAlpha)
 {
-    if (this->xVelocity_ <= 0 && this->yVelocity_ >= 0) { return "sw"; }
-    if (this->xVelocity_ >= 0 && this->yVelocity_ >= 0) { return "se"; }
-    if (this->xVelocity_ <= 0 && this->yVelocity_ <= 0) { return "nw"; }
-    return "ne";
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    //Two triangles per agent, all the herd in one call
+    this->vertices_.clear();
+    this->indices_.clear();
+    float vU = 1.0f / pAtlas.getSheet()->w;
+    float vV = 1.0f / pAtlas.getSheet()->h;
+    for (int vI = 0; vI < pView.size(); vI++)
+    {
+        const SDL_Rect& vFrame = *pView.frames_[vI];
+        SDL_Rect vTarget = this->camera_.toScreen(pView.getDrawX(vI, pAlpha), pView.getDrawY(vI, pAlpha), vFrame.w, vFrame.h);
+        if (!this->camera_.isVisible(vTarget))
+            continue;
+        int vFirst = (int)this->vertices_.size();
+        for (int vCorner = 0; vCorner < 4; vCorner++)
+        {
+            int vRight = vCorner & 1;
+            int vBottom = vCorner >> 1;
+            SDL_Vertex vVertex;
+            vVertex.position = { (float)(vTarget.x + vRight * vTarget.w), (float)(vTarget.y + vBottom * vTarget.h) };
+            vVertex.color = { 0xFF, 0xFF, 0xFF, 0xFF };
+            vVertex.tex_coord = { (vFrame.x + vRight * vFrame.w) * vU, (vFrame.y + vBottom * vFrame.h) * vV };
+            this->vertices_.push_back(vVertex);
+        }
+        for (int vCorner : { 0, 1, 2, 1, 3, 2 })
+            this->indices_.push_back(vFirst + vCorner);
+    }
+    if (!this->indices_.empty())
+        SDL_RenderGeometry(this->renderer_, pAtlas.getTexture(), this->vertices_.data(), (int)this->vertices_.size(), this->indices_.data(), (int)this->indices_.size());
+#else
+    //No geometry before SDL 2.0.18, still one texture for every copy
+    for (int vI = 0; vI < pView.size(); vI++)
+    {
+        const SDL_Rect& vFrame = *pView.frames_[vI];
+        SDL_Rect vTarget = this->camera_.toScreen(pView.getDrawX(vI, pAlpha), pView.getDrawY(vI, pAlpha), vFrame.w, vFrame.h);
+        if (this->camera_.isVisible(vTarget))
+            SDL_RenderCopy(this->renderer_, pAtlas.getTexture(), &vFrame, &vTarget);
+    }
+#endif
 }
-//*****************************************************************************
-//******************************** APPLICATION ********************************
-//*****************************************************************************
-application::application(int n_sheep,int n_wolf)
+/////////////////////////////////////////////
+void ground::queueHerd(herdView& pView, spriteAtlas& pAtlas, drawnHerd& pDrawn, float pAlpha)
 {
-    this->window_ptr_ = SDL_CreateWindow("W", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, frame_width, frame_height, 0);
-    this->window_surface_ptr_ = SDL_GetWindowSurface(this->window_ptr_);
-    if (this->window_ptr_ == NULL || this->window_surface_ptr_ == NULL) { exit(1); }
-    this->setGround(n_sheep, n_wolf);
+    //Both are sorted by serial, every agent meets its last drawing in one pass
+    this->drawing_.clear();
+    int vOld = 0;
+    for (int vI = 0; vI < pView.size(); vI++)
+    {
+        //Drawn last time but gone since : dead
+        uint32_t vSerial = pView.serials_[vI];
+        while (vOld < (int)pDrawn.serials_.size() && pDrawn.serials_[vOld] < vSerial)
+            this->damage(pDrawn.targets_[vOld++]);
+        SDL_Rect vDrawn = { 0, 0, 0, 0 };
+        const SDL_Rect* vDrawnFrame = NULL;
+        if (vOld < (int)pDrawn.serials_.size() && pDrawn.serials_[vOld] == vSerial)
+        {
+            vDrawn = pDrawn.targets_[vOld];
+            vDrawnFrame = pDrawn.frames_[vOld++];
+        }
+
+        const SDL_Rect& vFrame = *pView.frames_[vI];
+        drawCommand vCommand = { pAtlas.getSheet(), vFrame, this->camera_.toScreen(pView.getDrawX(vI, pAlpha), pView.getDrawY(vI, pAlpha), vFrame.w, vFrame.h) };
+        //Out of the window : only its old place is cleared
+        bool vVisible = this->camera_.isVisible(vCommand.target_);
+        if (!vVisible)
+            vCommand.target_ = { 0, 0, 0, 0 };
+        if (vDrawn.x != vCommand.target_.x || vDrawn.y != vCommand.target_.y || vDrawn.w != vCommand.target_.w || vDrawnFrame != &vFrame)
+        {
+            this->damage(vDrawn);
+            this->damage(vCommand.target_);
+        }
+        this->drawing_.serials_.push_back(vSerial);
+        this->drawing_.targets_.push_back(vCommand.target_);
+        this->drawing_.frames_.push_back(&vFrame);
+        if (vVisible)
+            this->commands_.push_back(vCommand);
+    }
+    while (vOld < (int)pDrawn.serials_.size())
+        this->damage(pDrawn.targets_[vOld++]);
+    std::swap(pDrawn, this->drawing_);
 }
 /////////////////////////////////////////////
-void application::setGround(int n_sheep, int n_wolf)
+void ground::damage(const SDL_Rect& pRect)
 {
-    this->ground_ = new ground(this->window_surface_ptr_);
-    for (int sheepNbr = 0; sheepNbr < n_sheep; sheepNbr++)
-        this->ground_->addMovingObject(new sheep(this->window_surface_ptr_));
-    for (int wolfNbr = 0; wolfNbr < n_wolf; wolfNbr++)
-        this->ground_->addMovingObject(new wolf(this->window_surface_ptr_));
-    this->ground_->addMovingObject(new shepherd(this->window_surface_ptr_));
+    if (pRect.w <= 0 || pRect.h <= 0)
+        return;
+    int vFirstColumn = std::max(pRect.x / TileSize, 0);
+    int vLastColumn = std::min((pRect.x + pRect.w - 1) / TileSize, TileColumns - 1);
+    int vFirstRow = std::max(pRect.y / TileSize, 0);
+    int vLastRow = std::min((pRect.y + pRect.h - 1) / TileSize, TileRows - 1);
+    for (int vRow = vFirstRow; vRow <= vLastRow; vRow++)
+        for (int vColumn = vFirstColumn; vColumn <= vLastColumn; vColumn++)
+            this->damagedTiles_[vRow * TileColumns + vColumn] = 1;
 }
 /////////////////////////////////////////////
-void application::loop(int duration)
+void ground::buildDamage()
 {
-    SDL_Event e;
-    int startTime = SDL_GetTicks();
-    //Loop
-    while (SDL_GetTicks() - startTime < duration * 1000)
+    //Consecutive damaged tiles of a row make one run, then the tiles are clean again
+    this->damage_.clear();
+    this->rowStarts_.resize(TileRows + 1);
+    for (int vRow = 0; vRow < TileRows; vRow++)
     {
-        //Check if cross clicked
-        while (SDL_PollEvent(&e)) 
-            if (e.type == SDL_QUIT)
-                exit(0); 
-        //Update screen
-        int startTimeUpdate = SDL_GetTicks();
-        this->ground_->update();
-        int updateDuration = SDL_GetTicks() - startTimeUpdate;
-        SDL_UpdateWindowSurface(this->window_ptr_);
-        //Wait
-        SDL_Delay(std::max(0, 1000 / FPS - updateDuration));
+        this->rowStarts_[vRow] = (int)this->damage_.size();
+        uint8_t* vTiles = &this->damagedTiles_[vRow * TileColumns];
+        for (int vColumn = 0; vColumn < TileColumns; vColumn++)
+        {
+            if (!vTiles[vColumn])
+                continue;
+            int vEnd = vColumn;
+            while (vEnd < TileColumns && vTiles[vEnd])
+                vTiles[vEnd++] = 0;
+            SDL_Rect vRun = { vColumn * TileSize, vRow * TileSize, vEnd * TileSize, (vRow + 1) * TileSize };
+            vRun.w = std::min(vRun.w, frame_width) - vRun.x;
+            vRun.h = std::min(vRun.h, frame_height) - vRun.y;
+            this->damage_.push_back(vRun);
+            vColumn = vEnd;
+        }
     }
-}
-//*****************************************************************************
-// ********************************** GROUND **********************************
-//*****************************************************************************
-ground::ground(SDL_Surface* window_surface_ptr)
-{
-    this->window_surface_ptr_ = window_surface_ptr;
-    this->movingObjects_ = {};
+    this->rowStarts_[TileRows] = (int)this->damage_.size();
 }
 /////////////////////////////////////////////
-void ground::addMovingObject(movingObject* pO)
+void ground::drawImage(const drawCommand& pCommand, const SDL_Rect& pClip)
 {
-    this->movingObjects_.push_back(pO);
+    SDL_Rect vVisible;
+    if (!SDL_IntersectRect(&pCommand.target_, &pClip, &vVisible))
+        return;
+    if (pCommand.target_.w != pCommand.frame_.w || pCommand.target_.h != pCommand.frame_.h)
+    {
+        //Zoomed : the whole frame is scaled, the clip keeps it inside the run
+        SDL_Rect vTarget = pCommand.target_;
+        SDL_SetClipRect(this->window_surface_ptr_, &pClip);
+        SDL_BlitScaled(pCommand.sheet_, &pCommand.frame_, this->window_surface_ptr_, &vTarget);
+        SDL_SetClipRect(this->window_surface_ptr_, NULL);
+        return;
+    }
+    //Only the visible part of the frame is copied
+    SDL_Rect vSource = { pCommand.frame_.x + vVisible.x - pCommand.target_.x, pCommand.frame_.y + vVisible.y - pCommand.target_.y, vVisible.w, vVisible.h };
+    //La position (et pas la taille) de ce rectangle dfinie l'endroit ou la surface est colle
+    SDL_Rect vRect = { vVisible.x, vVisible.y, 0, 0 };
+    SDL_BlitSurface(pCommand.sheet_, &vSource, this->window_surface_ptr_, &vRect);
 }
 /////////////////////////////////////////////
-void ground::update()
+int ground::countObjects(propertie pPropertie)
 {
-    this->drawGround();
-    this->makeInteract();
-    this->updateObjects();
-    this->removeDeads();
-    this->addNews();
+    int vCount = 0;
+    for (herd* vHerd : { &this->shepherds_, &this->wolfs_, &this->sheeps_ })
+        for (uint32_t vProperties : vHerd->properties_)
+            if (vProperties & (1u << (int)pPropertie))
+                vCount++;
+    return vCount;
 }
 /////////////////////////////////////////////
 void ground::drawGround()
 {
+    //Into the cached background, render copies the damaged parts from it
     SDL_Rect vRect = { 0,0,frame_width ,frame_height };
-    SDL_FillRect(this->window_surface_ptr_, &vRect, 0x04A88D);
+    SDL_FillRect(this->background_, &vRect, SDL_MapRGB(this->background_->format, 0x04, 0xA8, 0x8D));
+    std::fill(this->damagedTiles_.begin(), this->damagedTiles_.end(), 1);
+}
+/////////////////////////////////////////////
+void ground::drawProfile(const tickRecord& pRecord)
+{
+    //One bar per phase of the tick, a full width bar is a whole tick
+    static const Uint32 Colors[] = { 0xE74C3C, 0xF39C12, 0xF1C40F, 0x2ECC71, 0x3498DB, 0x9B59B6, 0xECF0F1 };
+    for (int vP = 0; vP < (int)phase::count; vP++)
+    {
+        double vShare = profiler::toMicroseconds(pRecord.durations_[vP]) * FPS / 1000000.0;
+        SDL_Rect vRect = { 4, 4 + vP * 8, (int)(std::min(vShare, 1.0) * (frame_width - 8)), 6 };
+        if (this->renderer_ != NULL)
+        {
+            SDL_SetRenderDrawColor(this->renderer_, (Colors[vP] >> 16) & 0xFF, (Colors[vP] >> 8) & 0xFF, Colors[vP] & 0xFF, 0xFF);
+            SDL_RenderFillRect(this->renderer_, &vRect);
+        }
+        else
+            SDL_FillRect(this->window_surface_ptr_, &vRect, Colors[vP]);
+    }
+}
+/////////////////////////////////////////////
+void ground::prepareBuffers(int pCount, int pChunkSize)
+{
+    //The buffers only grow with the sheep herd, the records with the number of chunks
+    int vChunkCount = (pCount + pChunkSize - 1) / pChunkSize;
+    if ((int)this->chunks_.size() < vChunkCount)
+        this->chunks_.resize(vChunkCount);
+    for (commandBuffer& vBuffer : this->buffers_)
+    {
+        vBuffer.clear();
+        if ((int)vBuffer.neighbours_.capacity() < this->sheeps_.size())
+            vBuffer.reserve((int)this->sheeps_.x_.capacity());
+    }
 }
 /////////////////////////////////////////////
 void ground::makeInteract()
 {
-    for (int vO1 = 0; vO1 < this->movingObjects_.size()-1; vO1++)
-        for (int vO2 = vO1 + 1; vO2 < this->movingObjects_.size(); vO2++)
+    //Every agent only writes itself during a parallel phase, the writes on the
+    //others are buffered per thread and applied in chunk order once it is over
+    //Nobody moves before the updates, the grids hold for the whole phase.
+    this->grid_.build(this->sheeps_, std::max(this->sheeps_.getWidthBox(), this->sheeps_.getHeightBox()) + 1);
+    this->wolfGrid_.build(this->wolfs_, std::max(this->wolfs_.getWidthBox(), this->wolfs_.getHeightBox()) + 1);
+    //Wolves : eat the preys they touch, hunt the closest one, run away from the shepherd
+    this->prepareBuffers(this->wolfs_.size(), WolfChunk);
+    this->pool_.run(this->wolfs_.size(), WolfChunk, [this](int pBegin, int pEnd, int pChunk, int pThread) {
+        this->interactWolfs(pBegin, pEnd, this->buffers_[pThread], this->chunks_[pChunk]); });
+    for (int vChunk = 0; vChunk * WolfChunk < this->wolfs_.size(); vChunk++)
+    {
+        chunkRecord& vRecord = this->chunks_[vChunk];
+        this->profiler_.addPairs(vRecord.pairs_);
+        for (int vK = vRecord.firstKill_; vK < vRecord.endKill_; vK++)
+            this->sheeps_.addPropertie(vRecord.buffer_->kills_[vK], propertie::dead);
+    }
+    int vHunters = 0;
+    long long vPreyDistances = 0;
+    for (int vW = 0; vW < this->wolfs_.size(); vW++)
+        if (this->wolfs_.getValue(vW, field::preyDistance) != -1)
+        {
+            vHunters++;
+            vPreyDistances += this->wolfs_.getValue(vW, field::preyDistance);
+        }
+    this->telemetry_.preyDistance_ = (vHunters > 0 ? (float)vPreyDistances / vHunters : -1);
+    //Sheeps : run away from the wolves, find the sheeps they can mate with
+    this->prepareBuffers(this->sheeps_.size(), SheepChunk);
+    this->pool_.run(this->sheeps_.size(), SheepChunk, [this](int pBegin, int pEnd, int pChunk, int pThread) {
+        this->interactSheeps(pBegin, pEnd, this->buffers_[pThread], this->chunks_[pChunk]); });
+    //Couples are found in ascending pair order, a sheep mates with the first one still available.
+    //Each sheep gave the first it could mate with, the others are looked at only if that one is taken
+    int vThreats = 0;
+    long long vThreatDistances = 0;
+    for (int vChunk = 0; vChunk * SheepChunk < this->sheeps_.size(); vChunk++)
+    {
+        chunkRecord& vRecord = this->chunks_[vChunk];
+        this->profiler_.addPairs(vRecord.pairs_);
+        vThreats += vRecord.threats_;
+        vThreatDistances += vRecord.threatDistances_;
+        int vPairs = 0;
+        for (int vC = vRecord.firstCouple_; vC < vRecord.endCouple_; vC++)
         {
-            this->movingObjects_[vO1]->interact(this->movingObjects_[vO2]);
-            this->movingObjects_[vO2]->interact(this->movingObjects_[vO1]);
+            std::pair<int, int> vCouple = vRecord.buffer_->couples_[vC];
+            if (sheep::canMate(this->sheeps_, vCouple.first, vCouple.second)
+                || this->findMate(std::min(vCouple.first, vCouple.second), this->buffers_[0].neighbours_, vCouple, vPairs))
+                sheep::mate(this->sheeps_, vCouple.first, vCouple.second);
         }
+        this->profiler_.addPairs(vPairs);
+    }
+    this->telemetry_.threatDistance_ = (vThreats > 0 ? (float)vThreatDistances / vThreats : -1);
 }
 /////////////////////////////////////////////
-void ground::updateObjects()
+void ground::interactWolfs(int pBegin, int pEnd, commandBuffer& pBuffer, chunkRecord& pChunk)
 {
-    for(movingObject* vMO: this->movingObjects_)
-        vMO->update();
+    //A wolf met the sheeps created before the shepherd, then the shepherd, then the lambs
+    int vLambs = (int)(std::lower_bound(this->sheeps_.serial_.begin(), this->sheeps_.serial_.end(), this->lambSerial_) - this->sheeps_.serial_.begin());
+    pChunk.begin(pBuffer);
+    for (int vW = pBegin; vW < pEnd; vW++)
+    {
+        //Scared or not, it eats the preys it touches
+        pBuffer.neighbours_.clear();
+        this->grid_.getOverlapping(this->wolfs_, vW, this->sheeps_, pBuffer.neighbours_);
+        for (int vS : pBuffer.neighbours_)
+            if (encounter<species::wolf, species::sheep>::meet(this->wolfs_, vW, this->sheeps_, vS))
+                pBuffer.kills_.push_back(vS);
+        pChunk.pairs_ += (int)pBuffer.neighbours_.size();
+        //Once scared it stops hunting, the lambs come too late
+        bool vScared = false;
+        for (int vS = 0; vS < this->shepherds_.size(); vS++)
+            vScared = vScared || this->wolfs_.getDistance(vW, this->shepherds_, vS) < wolf::traits::FleeRadius;
+        int vPrey = this->grid_.findNearest(this->wolfs_, vW, this->sheeps_, propertie::prey, INT_MAX, true, vScared ? vLambs : this->sheeps_.size());
+        if (vPrey != -1)
+        {
+            //It went toward every prey closer than the ones before, only the last one and those that drew a random velocity left a trace
+            int vLeft, vTop, vRight, vBottom;
+            this->wolfs_.getDrawingBox(vW, vLeft, vTop, vRight, vBottom);
+            pBuffer.neighbours_.clear();
+            this->grid_.getInBox(vLeft, vTop, vRight, vBottom, pBuffer.neighbours_);
+            std::sort(pBuffer.neighbours_.begin(), pBuffer.neighbours_.end());
+            for (int vS : pBuffer.neighbours_)
+            {
+                if (vS >= vPrey || !this->sheeps_.hasPropertie(vS, propertie::prey) || this->wolfs_.overlap(vW, this->sheeps_, vS)
+                    || !this->wolfs_.drawsToward(vW, this->sheeps_.getXBox(vS), this->sheeps_.getYBox(vS)))
+                    continue;
+                int vDistance = this->wolfs_.getDistance(vW, this->sheeps_, vS);
+                if (this->grid_.findNearest(this->wolfs_, vW, this->sheeps_, propertie::prey, vDistance + 1, true, vS) != -1)
+                    continue;
+                encounter<species::wolf, species::sheep>::meet(this->wolfs_, vW, this->sheeps_, vS);
+                pChunk.pairs_++;
+            }
+            encounter<species::wolf, species::sheep>::meet(this->wolfs_, vW, this->sheeps_, vPrey);
+            pChunk.pairs_++;
+        }
+        for (int vS = 0; vS < this->shepherds_.size(); vS++)
+            encounter<species::wolf, species::shepherd>::meet(this->wolfs_, vW, this->shepherds_, vS);
+        pChunk.pairs_ += this->shepherds_.size();
+    }
+    pChunk.end();
 }
 /////////////////////////////////////////////
-void ground::removeDeads()
+void ground::interactSheeps(int pBegin, int pEnd, commandBuffer& pBuffer, chunkRecord& pChunk)
 {
-    std::vector<movingObject*>::iterator it = this->movingObjects_.begin();
-    while (it != this->movingObjects_.end())
-        if ((*it)->hasPropertie("dead"))
+    pChunk.begin(pBuffer);
+    for (int vS1 = pBegin; vS1 < pEnd; vS1++)
+    {
+        //Runs away from every wolf close enough in creation order, the last one gives the way
+        int vX = this->sheeps_.getXBox(vS1);
+        int vY = this->sheeps_.getYBox(vS1);
+        int vRadius = sheep::traits::FleeRadius;
+        pBuffer.neighbours_.clear();
+        this->wolfGrid_.getInBox(vX - this->wolfs_.getWidthBox() - vRadius, vY - this->wolfs_.getHeightBox() - vRadius, vX + vRadius, vY + vRadius, pBuffer.neighbours_);
+        std::sort(pBuffer.neighbours_.begin(), pBuffer.neighbours_.end());
+        int vThreat = -1;
+        for (int vW : pBuffer.neighbours_)
+        {
+            int vDistance = this->sheeps_.getDistance(vS1, this->wolfs_, vW);
+            if (!this->wolfs_.hasPropertie(vW, propertie::wolf) || vDistance >= vRadius)
+                continue;
+            vThreat = (vThreat == -1 ? vDistance : std::min(vThreat, vDistance));
+            encounter<species::sheep, species::wolf>::meet(this->sheeps_, vS1, this->wolfs_, vW);
+            pChunk.pairs_++;
+        }
+        if (vThreat != -1)
         {
-            //delete(*it);
-            it = this->movingObjects_.erase(it);
+            pChunk.threats_++;
+            pChunk.threatDistances_ += vThreat;
         }
+        //Both must be ready
+        if (this->sheeps_.getValue(vS1, field::procreateTick) > this->sheeps_.now_)
+            continue;
+        std::pair<int, int> vCouple;
+        if (this->findMate(vS1, pBuffer.neighbours_, vCouple, pChunk.pairs_))
+            pBuffer.couples_.push_back(vCouple);
+    }
+    pChunk.end();
+}
+/////////////////////////////////////////////
+bool ground::findMate(int pSheep, std::vector<int>& pNeighbours, std::pair<int, int>& pCouple, int& pPairs)
+{
+    //The first sheep after it that it can mate with now, only sheeps in the neighbouring cells can overlap
+    pNeighbours.clear();
+    this->grid_.getNeighbours(pSheep, pNeighbours);
+    std::sort(pNeighbours.begin(), pNeighbours.end());
+    for (int vS2 : pNeighbours)
+    {
+        if (vS2 <= pSheep)
+            continue;
+        pPairs++;
+        if (sheep::canMate(this->sheeps_, pSheep, vS2))
+            pCouple = { pSheep, vS2 };
+        else if (sheep::canMate(this->sheeps_, vS2, pSheep))
+            pCouple = { vS2, pSheep };
         else
-            it++;
+            continue;
+        return true;
+    }
+    return false;
 }
 /////////////////////////////////////////////
-void ground::addNews()
+void ground::updateObjects()
+{
+    const int UpdateChunk = 1024;
+    this->pool_.run(this->sheeps_.size(), UpdateChunk, [this](int pBegin, int pEnd, int, int) {
+        this->updateRange(this->sheeps_, pBegin, pEnd); });
+    this->pool_.run(this->wolfs_.size(), UpdateChunk, [this](int pBegin, int pEnd, int, int) {
+        this->updateRange(this->wolfs_, pBegin, pEnd); });
+    //The keyboard belongs to the drawing thread, only the arrows it saw come here
+    int vArrows = this->arrows_.load(std::memory_order_relaxed);
+    this->arrowsRead_ = vArrows;
+    uint8_t vKeys[SDL_NUM_SCANCODES] = {};
+    for (int vA = 0; vA < 4; vA++)
+        vKeys[SDL_SCANCODE_RIGHT + vA] = (vArrows >> vA) & 1;
+    for (int vS = 0; vS < this->shepherds_.size(); vS++)
+        shepherd::move(this->shepherds_, vS, vArrows < 0 ? NULL : vKeys);
+    this->fireStarvations();
+}
+/////////////////////////////////////////////
+void ground::fireStarvations()
 {
-    int n = this->movingObjects_.size();
-    for (int i = 0; i < n - 1; i++)
+    //Only the wolves due this tick are visited, the ones that ate since go to their new deadline
+    int vW;
+    while ((vW = this->starvations_.getFirst(this->tick_)) != -1)
     {
-        movingObject* vMO = this->movingObjects_[i];
-        if (vMO->removePropertie("pregnant"))
-            this->addMovingObject(new sheep(this->window_surface_ptr_, vMO->getX(), vMO->getY()));
+        this->starvations_.remove(vW);
+        int vDeadline = this->wolfs_.getValue(vW, field::starveTick);
+        if (vDeadline > this->tick_)
+            this->starvations_.schedule(vDeadline, vW);
+        else
+            this->wolfs_.addPropertie(vW, propertie::dead);
     }
+}
+/////////////////////////////////////////////
+void ground::updateRange(herd& pHerd, int pBegin, int pEnd)
+{
+    //Agents do not depend on each other here, all the moves can come first
+    pHerd.moveRange(pBegin, pEnd);
+    for (int vI = pBegin; vI < pEnd; vI++)
+        if (pHerd.species_ == species::sheep)
+            sheep::updateState(pHerd, vI);
+        else
+            wolf::updateState(pHerd, vI);
+}
+/////////////////////////////////////////////
+void ground::removeDeads()
+{
+    //Only the wolves kill the sheeps, only hunger kills the wolves
+    this->shepherds_.removeIf(propertie::dead);
+    this->telemetry_.starvations_ = this->wolfs_.removeIf(propertie::dead);
+    this->telemetry_.predations_ = this->sheeps_.removeIf(propertie::dead);
+}
+/////////////////////////////////////////////
+void ground::addNews()
+{
+    //The agent created last was left out when every agent was in one list, it is the last lamb if there is one
+    int n = this->sheeps_.size();
+    if (n > 0 && (this->sheeps_.serial_[n - 1] >= this->lambSerial_ || this->wolfs_.size() + this->shepherds_.size() == 0))
+        n--;
+    for (int i = 0; i < n; i++)
+        if (this->sheeps_.removePropertie(i, propertie::pregnant))
+        {
+            sheep::add(this->sheeps_, this->sheeps_.x_[i], this->sheeps_.y_[i]);
+            this->telemetry_.births_++;
+        }
 }
\ No newline at end of file
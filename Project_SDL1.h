@@ -4,26 +4,252 @@
 #include <iostream> 
 #include <vector>
 #include <map>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <array>
+#include <utility>
+#include <fstream>
 constexpr int frame_width = 800;
 constexpr int frame_height = 700;;
 constexpr int FPS = 60;
 
+//*****************************************************************************
+// ********************************** RANDOM **********************************
+//*****************************************************************************
+//Counter-based generator : a draw only depends on the seed, the stream and the
+//counter, so an agent gets the same numbers whatever the thread updating it
+class counterRandom
+{
+public:
+    static uint32_t draw(uint64_t pSeed, uint64_t pStream, uint64_t pCounter);
+};
+//*****************************************************************************
+// ******************************* SPRITE ATLAS *******************************
+//*****************************************************************************
+class threadPool;
+//Every frame of a species packed in one surface, one row per animation
+class spriteAtlas
+{
+private:
+    SDL_Surface* sheet_;
+    SDL_Texture* texture_;//Copy of the sheet for SDL_Renderer, NULL until uploaded
+    std::vector<SDL_Rect> frames_;//Position of every frame in the sheet
+    std::vector<int> animationStarts_;//First frame of every animation
+
+public:
+    spriteAtlas();
+
+    void load(const std::vector<std::vector<std::string>>& pAnimations, threadPool& pPool);
+    void save(std::vector<char>& pOut);//Frames and ARGB8888 pixels, to call before optimize
+    size_t load(const char* pData, size_t pSize);//Bytes read, 0 if the data is not a whole atlas
+    void optimize(const SDL_PixelFormat* pFormat);//For blits on surfaces of this format
+    bool isLoaded() { return this->sheet_ != NULL; }
+    SDL_Surface* getSheet() { return this->sheet_; }
+    void upload(SDL_Renderer* pRenderer);
+    SDL_Texture* getTexture() { return this->texture_; }
+    const SDL_Rect& getFrame(int pAnimation, int pFrame) { return this->frames_[this->animationStarts_[pAnimation] + pFrame]; }
+};
+//Atlases decoded by an earlier run, valid as long as every image keeps its size and date
+const uint32_t AtlasCacheVersion = 1;
+bool loadAtlasCache(const std::string& pPath, const std::vector<spriteAtlas*>& pAtlases, const std::vector<std::vector<std::vector<std::string>>>& pPaths);
+bool saveAtlasCache(const std::string& pPath, const std::vector<spriteAtlas*>& pAtlases, const std::vector<std::vector<std::vector<std::string>>>& pPaths);
+
+//*****************************************************************************
+// *********************************** HERD ***********************************
+//*****************************************************************************
+enum class species
+{
+    shepherd, wolf, sheep,
+    count
+};
+constexpr int SpeciesCount = (int)species::count;
+enum class propertie
+{
+    shepherd, wolf, sheep, prey, canprocreate, male, female, dead, pregnant, scared,
+    count
+};
+enum class field
+{
+    preyDistance, starveTick, procreateTick,//Deadlines are absolute ticks
+    count
+};
+enum class direction
+{
+    nw, ne, sw, se
+};
+//Constants of every species, a new one only needs its own
+template <species S> struct speciesTraits;
+template <> struct speciesTraits<species::shepherd>
+{
+    static constexpr int Width = 49;
+    static constexpr int Height = 49;
+    static constexpr int Velocity = 4;
+    static constexpr int FrameInterval = 0;
+    static constexpr int FrameCount = 0;
+};
+template <> struct speciesTraits<species::wolf>
+{
+    static constexpr int Width = 157;
+    static constexpr int Height = 110;
+    static constexpr int Velocity = 4;
+    static constexpr int FrameInterval = 4;
+    static constexpr int FrameCount = 12;
+    static constexpr int FleeRadius = 150;//Runs away from a shepherd closer than this
+    static constexpr int StarveDelay = 400;//Ticks a wolf lives without eating
+};
+template <> struct speciesTraits<species::sheep>
+{
+    static constexpr int Width = 68;
+    static constexpr int Height = 60;
+    static constexpr int Velocity = 3;
+    static constexpr int FrameInterval = 10;
+    static constexpr int FrameCount = 10;
+    static constexpr int FleeRadius = 200;//Runs away from a wolf closer than this
+    static constexpr int ProcreateDelay = 500;//Ticks between two matings
+};
+
+class timingWheel;
+//What the string adapter keeps of the names it does not know, for one agent
+class extraRecord
+{
+public:
+    std::map<std::string, int> values_;
+    std::vector<std::string> properties_;
+};
+//Every agent of one species, one contiguous array per attribute
+class herd
+{
+public:
+    species species_;
+    int width_;
+    int height_;
+    int totalVelocity_;//At least 1
+    int frameInterval_;//Nombre d'appelle de update avant d'updateImage
+    int frameCount_;//Number of images per direction, 0 if not animated
+    uint64_t seed_;
+    uint32_t nextSerial_;
+    int worldWidth_;//Field the agents move in, the window by default
+    int worldHeight_;
+    int now_;//Tick being simulated, the deadlines are compared to it
+
+    std::vector<int> x_;
+    std::vector<int> y_;
+    std::vector<int> prevX_;//Position before the last tick, to interpolate the drawing
+    std::vector<int> prevY_;
+    std::vector<int> xVelocity_;
+    std::vector<int> yVelocity_;
+    std::vector<uint32_t> properties_;//One bit per propertie
+    std::vector<uint32_t> fieldsSet_;//One bit per field that has been set
+    std::vector<int> fields_[(int)field::count];
+    std::vector<int> frameDuration_;//Dure de la frame actuelle
+    std::vector<int> frameIndex_;
+    std::vector<int> direction_;//Direction of the current frame, -1 before the first one
+    std::vector<uint32_t> serial_;//Random stream of the agent
+    std::vector<uint32_t> draws_;//Numbers drawn from the stream so far
+    timingWheel* wheel_;//Deadlines of the agents, told when they move or go, NULL if they have none
+    std::map<uint32_t, extraRecord> extras_;//Slow path of the string adapter by serial, empty until a script uses a name it does not know
+
+    herd(species pSpecies, int width, int height, int totalVelocity, int frameInterval, int frameCount);
+
+    int size() { return (int)this->x_.size(); }
+    int add(int x, int y);
+    void resize(int pSize);
+    void reserve(int pCapacity);//Columns only grow, removed slots are reused by the next births
+    int removeIf(propertie pPropertie);//Number of agents removed
+
+    bool hasPropertie(int pIndex, propertie pPropertie) { return this->properties_[pIndex] & (1u << (int)pPropertie); }
+    void addPropertie(int pIndex, propertie pPropertie) { this->properties_[pIndex] |= 1u << (int)pPropertie; }
+    bool removePropertie(int pIndex, propertie pPropertie);//True if removed
+    bool hasValue(int pIndex, field pField) { return this->fieldsSet_[pIndex] & (1u << (int)pField); }
+    int getValue(int pIndex, field pField) { return this->fields_[(int)pField][pIndex]; }
+    void setValue(int pIndex, field pField, int pValue);
+    uint32_t random(int pIndex);
+    extraRecord* findExtras(int pIndex);//NULL if the agent has none
+
+    int getWidthBox() { return this->width_ / 2; }
+    int getHeightBox() { return this->height_ * 4 / 5; }
+    int getXBox(int pIndex) { return this->x_[pIndex] + (this->width_ - this->getWidthBox()) / 2; }
+    int getYBox(int pIndex) { return this->y_[pIndex] + (this->height_ - this->getHeightBox()) / 2; }
+    int getDrawX(int pIndex, float pAlpha) { return this->prevX_[pIndex] + (int)((this->x_[pIndex] - this->prevX_[pIndex]) * pAlpha); }
+    int getDrawY(int pIndex, float pAlpha) { return this->prevY_[pIndex] + (int)((this->y_[pIndex] - this->prevY_[pIndex]) * pAlpha); }
+    void savePositions();
+    bool overlap(int pIndex, herd& pHerd2, int pIndex2);
+    int getDistance(int pIndex, herd& pHerd2, int pIndex2);
+
+    bool canMoveX(int pIndex);
+    bool canMoveY(int pIndex);
+    void setRandomVelocitys(int pIndex);
+    void adjustVelocitys(int pIndex);
+    static int clampVelocity(int pVelocity, int pMin, int pMax);
+    static void limitSpeed(int& pXVelocity, int& pYVelocity, int pTotal);
+    void runAway(int pIndex, herd& pHerd2, int pIndex2);
+    void runAway(int pIndex, int x, int y);
+    void goToward(int pIndex, herd& pHerd2, int pIndex2);
+    void goToward(int pIndex, int x, int y);
+    bool drawsToward(int pIndex, int x, int y);//True if goToward would have to draw a random velocity
+    void getDrawingBox(int pIndex, int& pLeft, int& pTop, int& pRight, int& pBottom);//Every place goToward could draw for
+    void move(int pIndex);
+    void moveRange(int pBegin, int pEnd);//Same as move on each agent, several agents at a time
+
+    direction getDirection(int pIndex);
+    void updateFrameDuration(int pIndex);
+    void nextFrame(int pIndex);
+
+    //Every column of plain values, in the order of the snapshots
+    template <class F> void forEachColumn(F pFunction)
+    {
+        pFunction(this->x_); pFunction(this->y_); pFunction(this->prevX_); pFunction(this->prevY_);
+        pFunction(this->xVelocity_); pFunction(this->yVelocity_); pFunction(this->properties_); pFunction(this->fieldsSet_);
+        for (std::vector<int>& vField : this->fields_)
+            pFunction(vField);
+        pFunction(this->frameDuration_); pFunction(this->frameIndex_); pFunction(this->direction_);
+        pFunction(this->serial_); pFunction(this->draws_);
+    }
+    void save(std::vector<char>& pOut);
+    size_t load(const char* pData, size_t pSize);//Bytes read, 0 if they are not a herd of this species
+};
+
 //*****************************************************************************
 // ********************************** OBJECT **********************************
 //*****************************************************************************
+//Objects are views on one agent of a herd
 class object
 {
 protected:
-    std::map<std::string, int> values_;
-    std::vector<std::string> properties_;
+    herd* herd_;
+    int index_;
+
+    static bool findPropertie(const std::string& pName, propertie& pPropertie);
+    static bool findField(const std::string& pName, field& pField);
+    static bool findCountdown(const std::string& pName, field& pField, int& pShift);//Countdown names of before the deadlines, deadline = now_ + countdown + pShift
+
 public:
     object();
-    bool hasValue(std::string pKey);
-    int getValue(std::string pKey);
-    void setValue(std::string pKey, int pValue);
-    bool hasPropertie(std::string pPropertie);
-    bool removePropertie(std::string pPropertie);//True if removed
-    void addPropertie(std::string pPropertie);
+    object(herd* pHerd, int pIndex);
+
+    herd* getHerd() { return this->herd_; }
+    int getIndex() { return this->index_; }
+
+    bool hasValue(field pField) { return this->herd_->hasValue(this->index_, pField); }
+    int getValue(field pField) { return this->herd_->getValue(this->index_, pField); }
+    void setValue(field pField, int pValue) { this->herd_->setValue(this->index_, pField, pValue); }
+    bool hasPropertie(propertie pPropertie) { return this->herd_->hasPropertie(this->index_, pPropertie); }
+    bool removePropertie(propertie pPropertie) { return this->herd_->removePropertie(this->index_, pPropertie); }
+    void addPropertie(propertie pPropertie) { this->herd_->addPropertie(this->index_, pPropertie); }
+
+    //String adapter, for scripting
+    bool hasValue(const std::string& pKey);
+    int getValue(const std::string& pKey);
+    void setValue(const std::string& pKey, int pValue);
+    bool hasPropertie(const std::string& pPropertie);
+    bool removePropertie(const std::string& pPropertie);//True if removed
+    void addPropertie(const std::string& pPropertie);
 };
 
 //*****************************************************************************
@@ -31,21 +257,12 @@ public:
 //*****************************************************************************
 class renderedObject :public object
 {
-protected:
-    SDL_Surface* window_surface_ptr_;
-    SDL_Surface* image_ptr_;
-    int width_;
-    int height_;
-    int x_;
-    int y_;
-
 public:
-    renderedObject(SDL_Surface* image_ptr, SDL_Surface* window_surface_ptr, int width, int height, int x, int y);
+    renderedObject(herd* pHerd, int pIndex);
     renderedObject() = default;
 
     int getX();
     int getY();
-    void draw();
 
     bool overlap(renderedObject* pO2);
     int getDistance(renderedObject* pO2);
@@ -61,13 +278,11 @@ public:
 //*****************************************************************************
 class movingObject : public virtual renderedObject
 {
-protected:
-    int totalVelocity_;
-    int xVelocity_;
-    int yVelocity_;
 public:
-    movingObject(int totalVelocity);
+    movingObject() = default;
 
+    int getXVelocity();
+    int getYVelocity();
     void setRandomVelocitys();
     bool canMoveX();
     bool canMoveY();
@@ -77,9 +292,9 @@ public:
     void goToward(renderedObject* pO2);
     void goToward(int x, int y);
     void move();
+    void interact(renderedObject* pO2);//Through the encounter of the two species
 
     virtual void update() = 0;
-    virtual void interact(renderedObject* pO2) = 0;
 };
 //*****************************************************************************
 // ***************************** ANIMATED OBJECT ******************************
@@ -87,17 +302,13 @@ public:
 class animatedObject : public virtual renderedObject
 {
 protected:
-    std::map<std::string, std::vector<SDL_Surface*>> images_;
-    int frameDuration_;//Dure de la frame actuelle
-    int frameInterval_;//Nombre d'appelle de update avant d'updateImage
-    int frameIndex_;
-
-    static std::map<std::string, std::vector<SDL_Surface*>> createSurfaceMap(std::map<std::string, std::vector<std::string>>);
-    virtual std::string getImageKey() = 0;
+    //The four walking animations of a folder, in the order of direction
+    static std::vector<std::vector<std::string>> createPathMap(std::string pFolder, int pFrameCount);
 
 public:
-    animatedObject(int frameDuration);
+    animatedObject() = default;
 
+    int getFrameIndex();
     void updateFrameDuration();
     void nextFrame();
 
@@ -109,16 +320,21 @@ public:
 class shepherd : public movingObject
 {
 private:
-    static SDL_Surface* ShepherdImage;
-    static int ImgW;
-    static int ImgH;
-    void move();
+    static spriteAtlas Atlas;
 
 public:
-    shepherd(SDL_Surface* window_surface_ptr);
+    typedef speciesTraits<species::shepherd> traits;
+
+    shepherd(herd* pHerd, int pIndex);
+
+    static herd createHerd();
+    static int add(herd& pShepherds);
+    static std::vector<std::vector<std::string>> getImagePaths();//Frames of every animation
+    static spriteAtlas& getAtlas() { return Atlas; }
+    static const SDL_Rect& getFrame(herd& pShepherds, int pIndex);
+    static void move(herd& pShepherds, int pIndex, const uint8_t* keystate);
 
     void update();
-    void interact(renderedObject* pO2);
 };
 //*****************************************************************************
 // **********************************  WOLF ***********************************
@@ -126,21 +342,26 @@ public:
 class wolf : public animatedObject, public movingObject
 {
 private:
-    static std::map<std::string, std::vector<SDL_Surface*>> WolfImages;
-    static SDL_Surface* WolfImage;
-    static int ImgW;
-    static int ImgH;
-
-    std::string getImageKey();
-    static std::map<std::string, std::vector<std::string>> createPathMap();
+    static spriteAtlas Atlas;
+    static const int IdleAnimation = 4;//After the four directions
 
 public:
-    wolf(SDL_Surface* window_surface_ptr, int x, int y);
-    wolf(SDL_Surface* window_surface_ptr);
+    typedef speciesTraits<species::wolf> traits;
+
+    wolf(herd* pHerd, int pIndex);
+
+    static herd createHerd();
+    static int add(herd& pWolfs, int x, int y);
+    static int add(herd& pWolfs);
+    static std::vector<std::vector<std::string>> getImagePaths();//Frames of every animation
+    static spriteAtlas& getAtlas() { return Atlas; }
+    static const SDL_Rect& getFrame(herd& pWolfs, int pIndex);
+    static void meetShepherd(herd& pWolfs, int pWolf, herd& pShepherds, int pShepherd);
+    static bool meetPrey(herd& pWolfs, int pWolf, herd& pPreys, int pPrey);//True if the prey is eaten
+    static void update(herd& pWolfs, int pIndex);
+    static void updateState(herd& pWolfs, int pIndex);//Everything update does after moving
 
-    void updateTimeBeforeStarve();
     void update() override;
-    void interact(renderedObject* pO2);
 };
 //*****************************************************************************
 // ********************************** SHEEP **********************************
@@ -148,37 +369,615 @@ public:
 class sheep : public animatedObject, public movingObject
 {
 private:
-    static std::map<std::string, std::vector<SDL_Surface*>> SheepImagesM;
-    static std::map<std::string, std::vector<SDL_Surface*>> SheepImagesF;
-    static SDL_Surface* SheepImage;
-    static int ImgW;
-    static int ImgH;
-
-    std::string getImageKey();
-    static std::map<std::string, std::vector<std::string>> createPathMap(std::string pGender);
+    static spriteAtlas Atlas;
+    static const int MaleAnimations = 4;//Female directions first, then male ones
+    static const int IdleAnimation = 8;
 
 public:
-    sheep(SDL_Surface* window_surface_ptr, int x, int y);
-    sheep(SDL_Surface* window_surface_ptr);
+    typedef speciesTraits<species::sheep> traits;
+
+    sheep(herd* pHerd, int pIndex);
+
+    static herd createHerd();
+    static int add(herd& pSheeps, int x, int y);
+    static int add(herd& pSheeps);
+    static std::vector<std::vector<std::string>> getImagePaths();//Frames of every animation
+    static spriteAtlas& getAtlas() { return Atlas; }
+    static const SDL_Rect& getFrame(herd& pSheeps, int pIndex);
+    static void meetWolf(herd& pSheeps, int pSheep, herd& pWolfs, int pWolf);
+    static bool canMate(herd& pSheeps, int pMale, int pFemale);
+    static void mate(herd& pSheeps, int pMale, int pFemale);
+    static void update(herd& pSheeps, int pIndex);
+    static void updateState(herd& pSheeps, int pIndex);//Everything update does after moving
 
     void update() override;
-    void interact(renderedObject* pO2);
+};
+//*****************************************************************************
+// ******************************** ENCOUNTERS ********************************
+//*****************************************************************************
+//What an agent of species A does to one of species B, nothing unless specialized. True if the other is killed
+template <species A, species B> struct encounter
+{
+    static bool meet(herd&, int, herd&, int) { return false; }
+};
+template <> struct encounter<species::wolf, species::sheep>
+{
+    static bool meet(herd& pWolfs, int pWolf, herd& pSheeps, int pSheep) { return wolf::meetPrey(pWolfs, pWolf, pSheeps, pSheep); }
+};
+template <> struct encounter<species::wolf, species::shepherd>
+{
+    static bool meet(herd& pWolfs, int pWolf, herd& pShepherds, int pShepherd)
+    {
+        wolf::meetShepherd(pWolfs, pWolf, pShepherds, pShepherd);
+        return false;
+    }
+};
+template <> struct encounter<species::sheep, species::wolf>
+{
+    static bool meet(herd& pSheeps, int pSheep, herd& pWolfs, int pWolf)
+    {
+        sheep::meetWolf(pSheeps, pSheep, pWolfs, pWolf);
+        return false;
+    }
+};
+template <> struct encounter<species::sheep, species::sheep>
+{
+    static bool meet(herd& pSheeps, int pMale, herd& pOthers, int pFemale)
+    {
+        if (&pSheeps == &pOthers && sheep::canMate(pSheeps, pMale, pFemale))
+            sheep::mate(pSheeps, pMale, pFemale);
+        return false;
+    }
+};
+//Every (A, B) pair, indexed by A * SpeciesCount + B. Only movingObject::interact goes through it,
+//ground::interactWolfs and ground::interactSheeps name their pairs and have to be given the new ones
+typedef bool (*encounterFunction)(herd&, int, herd&, int);
+template <int... Pairs> constexpr std::array<encounterFunction, sizeof...(Pairs)> makeEncounters(std::integer_sequence<int, Pairs...>)
+{
+    return { { &encounter<(species)(Pairs / SpeciesCount), (species)(Pairs % SpeciesCount)>::meet... } };
+}
+constexpr std::array<encounterFunction, SpeciesCount * SpeciesCount> Encounters = makeEncounters(std::make_integer_sequence<int, SpeciesCount * SpeciesCount>());
+inline bool meet(herd& pHerd, int pIndex, herd& pOthers, int pOther)
+{
+    return Encounters[(int)pHerd.species_ * SpeciesCount + (int)pOthers.species_](pHerd, pIndex, pOthers, pOther);
+}
+//*****************************************************************************
+// ******************************* SPATIAL GRID *******************************
+//*****************************************************************************
+class spatialGrid
+{
+private:
+    int cellSize_;
+    int columns_;
+    int rows_;
+    std::vector<int> cellStarts_;//Index of the first agent of each cell in cellObjects_
+    std::vector<int> cellObjects_;//Agent indices sorted by cell, ascending inside a cell
+    std::vector<int> objectCells_;
+
+    int getColumn(int x);
+    int getRow(int y);
+    int getCell(int x, int y);
+
+public:
+    spatialGrid();
+
+    void build(herd& pHerd, int pCellSize);
+    void reserve(int pCount);
+    void getNeighbours(int pIndex, std::vector<int>& pNeighbours);
+    //Queries from an agent of another herd, pTargets must be the herd the grid was built on
+    void getOverlapping(herd& pHerd, int pIndex, herd& pTargets, std::vector<int>& pOverlapping);
+    int findNearest(herd& pHerd, int pIndex, herd& pTargets, propertie pPropertie, int pMaxDistance, bool pSkipOverlapping, int pBelow);//Only the targets before pBelow
+    void getInBox(int pLeft, int pTop, int pRight, int pBottom, std::vector<int>& pFound);//Every agent whose box starts in the cells of the box, and a few more
+};
+//*****************************************************************************
+// ******************************** THREAD POOL *******************************
+//*****************************************************************************
+//Runs a range split in fixed size chunks, the chunks are taken by the first free thread
+class threadPool
+{
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(int, int, int, int)>* task_;
+    int count_;
+    int chunkSize_;
+    int chunkCount_;
+    std::atomic<int> nextChunk_;
+    int generation_;
+    int busy_;
+    bool stop_;
+
+    void work(int pThread);
+    void workerLoop(int pThread);
+
+public:
+    threadPool(int pThreadCount);
+    ~threadPool();
+
+    int getThreadCount() { return (int)this->workers_.size() + 1; }
+    //pTask(begin, end, chunk, thread)
+    void run(int pCount, int pChunkSize, const std::function<void(int, int, int, int)>& pTask);
+};
+//*****************************************************************************
+// ****************************** COMMAND BUFFER ******************************
+//*****************************************************************************
+//Writes made on other agents by the chunks one thread runs in a parallel phase, applied once the phase is over.
+//One per thread, sized by the herd rather than by the chunks, so it stops growing with the population
+class commandBuffer
+{
+public:
+    std::vector<int> kills_;//Sheeps eaten
+    std::vector<std::pair<int, int>> couples_;//Male, female, at most one per sheep
+    std::vector<int> neighbours_;//Scratch for the grid queries
+
+    void clear();
+    void reserve(int pSheeps);
+};
+//Where one chunk left its writes in the buffer of its thread, and what it counted
+class chunkRecord
+{
+public:
+    commandBuffer* buffer_;
+    int firstKill_;
+    int endKill_;
+    int firstCouple_;
+    int endCouple_;
+    int pairs_;//Couples of agents handed to the meet functions
+    int threats_;//Sheeps with a wolf close enough to flee
+    long long threatDistances_;//Summed over them
+
+    chunkRecord();
+    void begin(commandBuffer& pBuffer);
+    void end();
+};
+//*****************************************************************************
+// ********************************* PROFILER *********************************
+//*****************************************************************************
+enum class phase { interact, update, removeDeads, addNews, drawGround, drawAgents, present, count };
+//Cost and population of one tick, the drawing done since the previous tick included
+class tickRecord
+{
+public:
+    uint64_t durations_[(int)phase::count];//Performance counter units
+    int sheeps_;
+    int wolfs_;
+    int pairs_;//Interaction pairs tested
+
+    tickRecord();
+};
+/////////////////////////////////////////////
+//Keeps the last ticks in a ring buffer, nothing is allocated once built
+class profiler
+{
+private:
+    std::vector<tickRecord> records_;
+    std::vector<double> scratch_;//For the percentiles
+    int next_;
+    int count_;
+    int ticks_;//Since the start
+    tickRecord current_;
+    std::atomic<uint64_t> durations_[(int)phase::count];//Of current_, the drawing thread adds to them too
+
+public:
+    static const int Capacity = 4096;
+
+    profiler();
+
+    static const char* getPhaseName(phase pPhase);
+    static double toMicroseconds(uint64_t pDuration);
+    void add(phase pPhase, uint64_t pDuration) { this->durations_[(int)pPhase].fetch_add(pDuration, std::memory_order_relaxed); }
+    void addPairs(int pPairs) { this->current_.pairs_ += pPairs; }
+    void endTick(int pSheeps, int pWolfs);
+    const tickRecord& getLast();
+    double getPercentile(phase pPhase, double pRank);//In microseconds, over the ticks kept
+    bool writeCsv(const std::string& pPath);
+};
+/////////////////////////////////////////////
+//Adds the time until its destruction to a phase
+class scopedTimer
+{
+private:
+    profiler& profiler_;
+    phase phase_;
+    uint64_t start_;
+
+public:
+    scopedTimer(profiler& pProfiler, phase pPhase);
+    ~scopedTimer();
+};
+//*****************************************************************************
+// ******************************** TELEMETRY *********************************
+//*****************************************************************************
+//Population dynamics of one tick
+class telemetryRecord
+{
+public:
+    int tick_;
+    int sheeps_;
+    int wolfs_;
+    int births_;
+    int predations_;//Sheeps eaten
+    int starvations_;//Wolves dead of hunger
+    float preyDistance_;//Mean distance of the hunting wolves to their prey, -1 if none hunts
+    float threatDistance_;//Mean distance of the fleeing sheeps to their wolf, -1 if none flees
+
+    telemetryRecord();
+};
+/////////////////////////////////////////////
+//Streams the records to a file from its own thread, the ticks only append to a queue.
+//CSV if the path ends with .csv, else binary columns : a header, then blocks of records column by column
+class telemetryWriter
+{
+private:
+    static const int BatchSize = 256;//Records handed to the thread at once
+    std::ofstream file_;
+    bool binary_;
+    std::vector<telemetryRecord> pending_;//Filled by the ticks
+    std::vector<telemetryRecord> writing_;//Owned by the thread
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool closing_;
+    std::thread thread_;
+
+    std::vector<char> scratch_;//One block of binary columns
+
+    void run();
+    void write(const std::vector<telemetryRecord>& pRecords);
+    template <class T> void appendColumn(const std::vector<telemetryRecord>& pRecords, T telemetryRecord::* pMember);
+
+public:
+    telemetryWriter(const std::string& pPath);
+    ~telemetryWriter();
+
+    bool isOpen() { return this->file_.is_open(); }
+    void push(const telemetryRecord& pRecord);
+    void close();//Writes what is left and waits for the thread
+};
+//*****************************************************************************
+// ********************************** REPLAY **********************************
+//*****************************************************************************
+//A run is replayed from its settings and the keys the shepherd read on every tick. After the header,
+//the ticks come in runs of the same keys : the run length, then the change from the keys of the run before, as varints
+const uint32_t ReplayVersion = 1;
+class settings;
+class replayWriter
+{
+private:
+    std::ofstream file_;
+    int arrows_;//Of the run being counted
+    uint32_t count_;//Ticks in it
+    int written_;//Keys of the last run written
+
+    void flush();
+
+public:
+    replayWriter(const std::string& pPath, const settings& pSettings);
+    ~replayWriter();
+
+    bool isOpen() { return this->file_.is_open(); }
+    void record(int pArrows);//Keys read by one tick
+    void close();
+};
+/////////////////////////////////////////////
+class replayReader
+{
+private:
+    std::vector<std::pair<uint32_t, int>> runs_;//Length and keys
+    int run_;
+    uint32_t used_;//Ticks of the current run already given
+    int ticks_;//In the whole log
+
+public:
+    replayReader();
+
+    bool open(const std::string& pPath, settings& pSettings);//Takes the settings of the recorded run, false if the file is not a replay
+    int getTicks() { return this->ticks_; }
+    int next();//Keys of the next tick
+};
+//*****************************************************************************
+// ********************************** EXPORT **********************************
+//*****************************************************************************
+//Frames drawn off screen and encoded by worker threads, straight from the surfaces of a bounded pool.
+//A path ending with .png or .qoi gives numbered images (run.png : run000000.png, run000001.png...), .y4m one raw video
+class frameExporter
+{
+private:
+    enum class encoding { png, qoi, y4m };
+
+    std::string path_;
+    encoding encoding_;
+    int width_;
+    int height_;
+    std::vector<SDL_Surface*> frames_;//The pool, all in SDL_PIXELFORMAT_RGB888
+    std::vector<SDL_Surface*> free_;//Ready to be drawn
+    std::deque<std::pair<SDL_Surface*, int>> pending_;//Drawn, with their number, waiting for a worker
+    std::vector<std::vector<char>> scratch_;//One per worker
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::ofstream stream_;//Y4M only
+    int submitted_;
+    int written_;//Y4M frames are written in order, the next one to write
+    bool closing_;
+    bool failed_;
+
+    void work(int pWorker);
+    bool encode(SDL_Surface* pFrame, int pNumber, std::vector<char>& pScratch);
+    void encodeQoi(SDL_Surface* pFrame, std::vector<char>& pOut);
+    void encodeYuv(SDL_Surface* pFrame, std::vector<char>& pOut);
+
+public:
+    frameExporter(const std::string& pPath, int pWidth, int pHeight, int pWorkers);
+    ~frameExporter();
+
+    bool isOpen() { return !this->frames_.empty(); }
+    SDL_Surface* acquire();//A frame to draw, waits while every frame is being encoded
+    void submit(SDL_Surface* pFrame);//Numbered in the order they are submitted
+    bool close();//Waits for the encoding of every frame, false if one could not be written
+};
+//*****************************************************************************
+// ********************************* SNAPSHOT *********************************
+//*****************************************************************************
+//A snapshot is this header, then for every herd a herdHeader followed by its columns as they are in memory,
+//then its slow path values. Every block starts on SnapshotAlignment bytes, so a mapped file can be read in place
+const int SnapshotAlignment = 64;
+const uint32_t SnapshotVersion = 4;
+class snapshotHeader
+{
+public:
+    char magic_[8];//"WSSNAP" and zeros
+    uint32_t version_;
+    uint32_t herdCount_;
+    uint64_t size_;//Of the whole file
+    uint64_t tick_;//Next tick to simulate, the deadlines of the agents count from the same start
+    uint64_t lambSerial_;//ground::lambSerial_
+    uint8_t padding_[24];
+};
+/////////////////////////////////////////////
+class herdHeader
+{
+public:
+    uint32_t species_;
+    uint32_t count_;//Agents, every column holds count_ values of 4 bytes
+    uint32_t columnCount_;
+    uint32_t nextSerial_;
+    int32_t worldWidth_;
+    int32_t worldHeight_;
+    uint64_t seed_;
+    uint64_t extrasSize_;//Bytes of slow path values after the columns
+    uint8_t padding_[24];
+};
+static_assert(sizeof(snapshotHeader) == SnapshotAlignment && sizeof(herdHeader) == SnapshotAlignment, "Snapshot headers fill one block");
+/////////////////////////////////////////////
+//Read only view of a whole file, mapped in memory rather than copied
+class mappedFile
+{
+private:
+    const char* data_;
+    size_t size_;
+    void* handles_[2];//File and mapping, as the system needs them
+
+public:
+    mappedFile(const std::string& pPath);
+    ~mappedFile();
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    bool isOpen() { return this->data_ != NULL; }
+    const char* getData() { return this->data_; }
+    size_t getSize() { return this->size_; }
+};
+//*****************************************************************************
+// ********************************** CAMERA **********************************
+//*****************************************************************************
+//Part of the world shown in the window
+class camera
+{
+private:
+    void clamp();
+
+public:
+    float x_;//World position of the top left corner of the window
+    float y_;
+    float zoom_;//Window pixels per world pixel
+    int worldWidth_;
+    int worldHeight_;
+
+    camera(int pWorldWidth, int pWorldHeight);
+
+    void centerOn(float x, float y);
+    void scroll(float pDx, float pDy);//In window pixels
+    void zoom(float pFactor);//Around the center of the window
+    float getMinZoom();//The whole world fits in the window
+    SDL_Rect toScreen(int x, int y, int w, int h);
+    bool isVisible(const SDL_Rect& pScreenRect);
+};
+//*****************************************************************************
+// ******************************* TIMING WHEEL *******************************
+//*****************************************************************************
+//Deadlines at most Size - 1 ticks ahead, one slot per tick. A slot is a list linked through the agent
+//indices, patched by the herd as it moves them. The deadline of the agent itself tells if it is due or later
+class timingWheel
+{
+private:
+    std::vector<int> heads_;//First agent of every slot, -1 if empty
+    std::vector<int> next_;//By agent, -1 at the end of its slot
+    std::vector<int> previous_;//-1 at the start of its slot
+    std::vector<int> slots_;//-1 if the agent is not in the wheel
+
+public:
+    static const int Size = 512;
+
+    timingWheel() : heads_(Size, -1) {}
+
+    void schedule(int pTick, int pIndex);//The agent must not be in the wheel
+    void remove(int pIndex);//If in the wheel
+    void move(int pFrom, int pTo);//The agent took a free index
+    int getFirst(int pTick) { return this->heads_[pTick % Size]; }
+    void reserve(int pCount);//Agents, the wheel itself never grows
+    void clear();
+};
+static_assert(wolf::traits::StarveDelay < timingWheel::Size, "A starvation deadline fits in the wheel");
+//*****************************************************************************
+// ********************************** VIEWS ***********************************
+//*****************************************************************************
+//What the drawing needs of a herd at the end of a tick, in the order of the herd
+class herdView
+{
+public:
+    std::vector<int> prevX_;
+    std::vector<int> prevY_;
+    std::vector<int> x_;
+    std::vector<int> y_;
+    std::vector<const SDL_Rect*> frames_;//In the atlas of the species
+    std::vector<uint32_t> serials_;//Ascending : agents are only appended and compaction keeps their order
+
+    int size() { return (int)this->x_.size(); }
+    int getDrawX(int pIndex, float pAlpha) { return this->prevX_[pIndex] + (int)((this->x_[pIndex] - this->prevX_[pIndex]) * pAlpha); }
+    int getDrawY(int pIndex, float pAlpha) { return this->prevY_[pIndex] + (int)((this->y_[pIndex] - this->prevY_[pIndex]) * pAlpha); }
+};
+/////////////////////////////////////////////
+//Every herd after one tick, never changed once published
+class worldView
+{
+public:
+    herdView herds_[SpeciesCount];
+    tickRecord profile_;//Of that tick
+    uint64_t time_;//Performance counter when the tick was due
+
+    herdView& getHerd(species pSpecies) { return this->herds_[(int)pSpecies]; }
+};
+/////////////////////////////////////////////
+//Triple buffer between the simulation and the drawing : each side owns one view, the third is
+//the last one published. Handing a view over is one atomic exchange, neither side waits
+class viewBuffer
+{
+private:
+    static const int Fresh = 4;//Set on the published index until the drawing takes it
+
+    worldView views_[3];
+    std::atomic<int> published_;
+    int writing_;
+    int reading_;
+
+public:
+    viewBuffer() : published_(1), writing_(0), reading_(2) {}
+
+    worldView& getWriting() { return this->views_[this->writing_]; }
+    void publish() { this->writing_ = this->published_.exchange(this->writing_ | Fresh, std::memory_order_acq_rel) & ~Fresh; }
+    bool acquire();//True if a newer view than the one read is there
+    worldView& getReading() { return this->views_[this->reading_]; }
 };
 //*****************************************************************************
 // ********************************** GROUND **********************************
 //*****************************************************************************
+//One agent to draw this frame
+class drawCommand
+{
+public:
+    SDL_Surface* sheet_;
+    SDL_Rect frame_;
+    SDL_Rect target_;
+};
+/////////////////////////////////////////////
+//What the window shows of a herd, by ascending serial
+class drawnHerd
+{
+public:
+    std::vector<uint32_t> serials_;
+    std::vector<SDL_Rect> targets_;//w = 0 when out of the window
+    std::vector<const SDL_Rect*> frames_;
+
+    void clear() { this->serials_.clear(); this->targets_.clear(); this->frames_.clear(); }
+};
+
 class ground
 {
 private:
+    //Dirty rectangles : only the tiles where something changed are redrawn and presented
+    static const int TileSize = 32;
+    static const int TileColumns = (frame_width + TileSize - 1) / TileSize;
+    static const int TileRows = (frame_height + TileSize - 1) / TileSize;
+
     SDL_Surface* window_surface_ptr_;
-    std::vector<movingObject*> movingObjects_;
+    SDL_Surface* background_;//The ground alone, painted once
+    SDL_Renderer* renderer_;//Replaces the window surface when set
+    camera camera_;
+    herd shepherds_;
+    herd wolfs_;
+    herd sheeps_;
+    spatialGrid grid_;//Sheeps
+    spatialGrid wolfGrid_;
+    threadPool pool_;
+    std::vector<commandBuffer> buffers_;//One per thread
+    std::vector<chunkRecord> chunks_;//One per chunk of the phase running
+    profiler profiler_;
+    std::vector<uint8_t> damagedTiles_;//One per tile, kept until the next render
+    std::vector<SDL_Rect> damage_;//Runs of damaged tiles, row by row
+    std::vector<int> rowStarts_;//First run of every row, then the number of runs
+    std::vector<drawCommand> commands_;
+    drawnHerd drawn_[SpeciesCount];//As of the last render
+    drawnHerd drawing_;//Scratch, swapped with the one being drawn
+    worldView view_;//Only for update, which simulates and draws on the same thread
+    std::atomic<int> arrows_;//Arrow keys held, a bit per scancode from SDL_SCANCODE_RIGHT, -1 without a keyboard
+    int arrowsRead_;//By the last tick
+    int tick_;//Ticks simulated since the start
+    uint32_t lambSerial_;//Serial of the next sheep when the last wolf or shepherd was added, the sheeps from it were created after them
+    timingWheel starvations_;//Of the wolves
+    static const int WolfChunk = 4;//Agents per chunk of the interaction phase
+    static const int SheepChunk = 256;
+    telemetryRecord telemetry_;//Of the last tick
+    std::vector<SDL_Vertex> vertices_;//Batch of the renderer, two triangles per agent
+    std::vector<int> indices_;
+    bool overlay_;
+
+    void drawImage(const drawCommand& pCommand, const SDL_Rect& pClip);
+    void damage(const SDL_Rect& pRect);
+    void queueHerd(herdView& pView, spriteAtlas& pAtlas, drawnHerd& pDrawn, float pAlpha);
+    void buildDamage();
+    void renderBatches(worldView& pView, float pAlpha);
+    void drawBatch(herdView& pView, spriteAtlas& pAtlas, float pAlpha);
+    void publishHerd(herd& pHerd, const SDL_Rect& (*pGetFrame)(herd&, int), herdView& pView);
+    void prepareBuffers(int pCount, int pChunkSize);
+    void interactWolfs(int pBegin, int pEnd, commandBuffer& pBuffer, chunkRecord& pChunk);
+    void interactSheeps(int pBegin, int pEnd, commandBuffer& pBuffer, chunkRecord& pChunk);
+    bool findMate(int pSheep, std::vector<int>& pNeighbours, std::pair<int, int>& pCouple, int& pPairs);
+    void updateRange(herd& pHerd, int pBegin, int pEnd);
+    void fireStarvations();
 
 public:
-    ground(SDL_Surface* window_surface_ptr);
+    ground(SDL_Surface* window_surface_ptr, int pThreadCount, uint64_t pSeed);
+
+    void setWorld(int pWidth, int pHeight);//Before the first agent is added
+    bool saveSnapshot(const std::string& pPath);
+    bool loadSnapshot(const std::string& pPath);//Replaces every agent and the world, false if the file is not a snapshot
+    void addShepherd();
+    void addWolf();
+    void addSheep();
+    void reserve(int pSheeps, int pWolfs);
+    shepherd getShepherd(int pIndex);
+    wolf getWolf(int pIndex);
+    sheep getSheep(int pIndex);
 
-    void addMovingObject(movingObject* pO);
     void drawGround();
     void update();
+    void simulate();
+    void publish(worldView& pView);//Copies what the drawing needs of the last tick
+    void render(worldView& pView, float pAlpha);//0 draws the tick before the view, 1 the view itself
+    void setTarget(SDL_Surface* pSurface);//Of the same size and format as the window, fully redrawn by the next render
+    void setArrows(const uint8_t* pKeys);//Held keys read by the shepherd on the next tick
+    void setArrowBits(int pArrows) { this->arrows_.store(pArrows, std::memory_order_relaxed); }
+    int getArrowsRead() { return this->arrowsRead_; }
+    const std::vector<SDL_Rect>& getDamage() { return this->damage_; }//What the last render changed on screen
+    void setOverlay(bool pOverlay) { this->overlay_ = pOverlay; }
+    void setRenderer(SDL_Renderer* pRenderer) { this->renderer_ = pRenderer; }
+    camera& getCamera() { return this->camera_; }
+    void drawProfile(const tickRecord& pRecord);
+    profiler& getProfiler() { return this->profiler_; }
+    const telemetryRecord& getTelemetry() { return this->telemetry_; }
+    int countObjects(propertie pPropertie);
     void makeInteract();
     void updateObjects();
     void removeDeads();
@@ -187,16 +986,56 @@ public:
 //*****************************************************************************
 // *******************************  APPLICATION  ******************************
 //*****************************************************************************
+//Options given on the command line
+class settings
+{
+public:
+    int sheeps_;
+    int wolfs_;
+    int duration_;//In seconds
+    bool headless_;
+    int threads_;
+    uint64_t seed_;//Same seed, same run, whatever the machine and the thread count
+    std::string profilePath_;//CSV written at the end, none if empty
+    bool overlay_;//Phase durations drawn over the ground
+    bool accelerated_;//Draw through SDL_Renderer instead of blitting on the window surface
+    int worldWidth_;//Field of the simulation, the window only shows a part of it
+    int worldHeight_;
+    std::string loadPath_;//Snapshot to start from instead of new agents, none if empty
+    std::string savePath_;//Snapshot written at the end, none if empty
+    std::string telemetryPath_;//Population of every tick, streamed while running, none if empty
+    std::string assetsPath_;//Decoded images kept between runs, none if empty
+    std::string recordPath_;//Replay log written while running, none if empty
+    std::string replayPath_;//Replay log to run again instead of these settings, none if empty
+    std::string exportPath_;//Frames of every tick, drawn without a window, none if empty
+
+    settings();
+};
+/////////////////////////////////////////////
 class application
 {
 private:
     SDL_Window* window_ptr_;
     SDL_Surface* window_surface_ptr_;
+    SDL_Renderer* renderer_;
     ground* ground_;
+    settings settings_;
+    telemetryWriter* telemetry_;//NULL if not asked for
+    replayWriter* recorder_;//NULL if not asked for
+    replayReader* replay_;//NULL unless replaying, the keys then come from it
+    frameExporter* exporter_;//NULL if not asked for, replaces the window
+    viewBuffer views_;//From the simulation thread to the drawing one
+    std::atomic<bool> stop_;//Asked by the drawing thread
+    std::atomic<bool> done_;//Set by the simulation thread once its last tick is published
+
+    void simulate();
+    void runSimulation(int pTicks);
+    void exportFrames(int pTicks);
+    void loadImages();
 
 public:
-    application(int n_sheep, int n_wolf); 
+    application(const settings& pSettings);
 
-    void setGround(int n_sheep, int n_wolf);
+    void setGround(const settings& pSettings);
     void loop(int duration);
 };
\ No newline at end of file
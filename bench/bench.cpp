@@ -0,0 +1,502 @@
+#include "Project_SDL1.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//*****************************************************************************
+// ******************************** ALLOCATIONS *******************************
+//*****************************************************************************
+//Every heap allocation of the process is counted, to check the ticks do none once warm
+static std::atomic<long long> Allocations(0);
+//GCC sees the malloc of the replaced new freed by the replaced delete and takes them for a mismatch
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t pSize)
+{
+    Allocations.fetch_add(1, std::memory_order_relaxed);
+    void* vPointer = std::malloc(pSize ? pSize : 1);
+    if (vPointer == NULL)
+        throw std::bad_alloc();
+    return vPointer;
+}
+void* operator new[](std::size_t pSize) { return operator new(pSize); }
+void operator delete(void* pPointer) noexcept { std::free(pPointer); }
+void operator delete[](void* pPointer) noexcept { std::free(pPointer); }
+void operator delete(void* pPointer, std::size_t) noexcept { std::free(pPointer); }
+void operator delete[](void* pPointer, std::size_t) noexcept { std::free(pPointer); }
+
+//*****************************************************************************
+// ********************************* SCENARIOS ********************************
+//*****************************************************************************
+class scenario
+{
+public:
+    std::string name_;
+    int sheeps_;
+    int wolfs_;
+    int ticks_;
+    int world_;//Side of the square field, 0 for the window
+    int reserve_;//Sheeps the herd is sized for, the run must never go beyond
+};
+//Same seed, same populations and same work on every run
+static const scenario Scenarios[] = {
+    { "sheep1k", 1000, 3, 600, 0, 2000 },
+    { "sheep10k", 10000, 5, 120, 0, 20000 },
+    { "sheep100k", 100000, 10, 10, 0, 200000 },
+    { "predators", 500, 200, 600, 0, 1000 },
+    { "breeding", 200, 0, 1800, 0, 8000 },
+    { "world100k", 100000, 50, 60, 20000, 200000 },
+    //The field grows with the population, one sheep per 4000 square pixels and one wolf per 2000 sheeps.
+    //The cost of a tick should grow about like the agents
+    { "density2k", 2000, 1, 60, 2828, 4000 },
+    { "density10k", 10000, 5, 60, 6325, 20000 },
+    { "density50k", 50000, 25, 60, 14142, 100000 },
+    { "density100k", 100000, 50, 60, 20000, 200000 },
+};
+
+/////////////////////////////////////////////
+long long getPeakRssKb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS vCounters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &vCounters, sizeof(vCounters)))
+        return -1;
+    return (long long)vCounters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage vUsage;
+    if (getrusage(RUSAGE_SELF, &vUsage) != 0)
+        return -1;
+#ifdef __APPLE__
+    return vUsage.ru_maxrss / 1024;
+#else
+    return vUsage.ru_maxrss;
+#endif
+#endif
+}
+/////////////////////////////////////////////
+//Runs one scenario and returns its JSON object, pAllocations gets the allocations once warm
+std::string runScenario(const scenario& pScenario, int pThreads, uint64_t pSeed, long long& pAllocations)
+{
+    ground vGround(NULL, pThreads, pSeed);
+    if (pScenario.world_ > 0)
+        vGround.setWorld(pScenario.world_, pScenario.world_);
+    vGround.reserve(pScenario.reserve_, pScenario.wolfs_);
+    for (int vS = 0; vS < pScenario.sheeps_; vS++)
+        vGround.addSheep();
+    for (int vW = 0; vW < pScenario.wolfs_; vW++)
+        vGround.addWolf();
+    vGround.addShepherd();
+
+    //The first tenth of the run warms the buffers up, allocations are counted after it
+    int vWarmup = pScenario.ticks_ / 10;
+    long long vAllocations = 0;
+    long long vAgentTicks = 0;
+    std::chrono::steady_clock::time_point vStart = std::chrono::steady_clock::now();
+    for (int vTick = 0; vTick < pScenario.ticks_; vTick++)
+    {
+        long long vBefore = Allocations.load(std::memory_order_relaxed);
+        vGround.simulate();
+        if (vTick >= vWarmup)
+            vAllocations += Allocations.load(std::memory_order_relaxed) - vBefore;
+        const tickRecord& vRecord = vGround.getProfiler().getLast();
+        vAgentTicks += vRecord.sheeps_ + vRecord.wolfs_ + 1;
+    }
+    double vSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - vStart).count();
+
+    std::ostringstream vJson;
+    vJson << "{\"name\": \"" << pScenario.name_ << "\", \"threads\": " << pThreads
+        << ", \"sheep\": " << pScenario.sheeps_ << ", \"wolves\": " << pScenario.wolfs_ << ", \"ticks\": " << pScenario.ticks_
+        << ", \"seconds\": " << vSeconds
+        << ", \"ticks_per_second\": " << pScenario.ticks_ / vSeconds
+        << ", \"ns_per_agent_tick\": " << vSeconds * 1e9 / std::max(vAgentTicks, 1LL)
+        << ", \"final_sheep\": " << vGround.countObjects(propertie::sheep)
+        << ", \"final_wolves\": " << vGround.countObjects(propertie::wolf)
+        << ", \"steady_allocations\": " << vAllocations
+        << ", \"peak_rss_kb\": " << getPeakRssKb()
+        << ", \"phases_p50_us\": {";
+    for (int vP = 0; vP <= (int)phase::addNews; vP++)
+        vJson << (vP ? ", " : "") << "\"" << profiler::getPhaseName((phase)vP) << "\": " << vGround.getProfiler().getPercentile((phase)vP, 0.5);
+    vJson << "}}";
+    pAllocations = vAllocations;
+    return vJson.str();
+}
+/////////////////////////////////////////////
+//The one unit at a time loops herd::adjustVelocitys used to run, kept as the reference
+void adjustVelocitysLoop(herd& pHerd, int pIndex)
+{
+    int& xVelocity = pHerd.xVelocity_[pIndex];
+    int& yVelocity = pHerd.yVelocity_[pIndex];
+    while (!pHerd.canMoveX(pIndex) && xVelocity != 0)
+        xVelocity -= (xVelocity > 0 ? 1 : -1);
+    while (!pHerd.canMoveY(pIndex) && yVelocity != 0)
+        yVelocity -= (yVelocity > 0 ? 1 : -1);
+    while (abs(xVelocity) + abs(yVelocity) > abs(pHerd.totalVelocity_))
+    {
+        xVelocity -= (xVelocity > 0 ? 1 : -1);
+        if (abs(xVelocity) + abs(yVelocity) > abs(pHerd.totalVelocity_))
+            yVelocity -= (yVelocity > 0 ? 1 : -1);
+    }
+    if (abs(xVelocity) + abs(yVelocity) < abs(pHerd.totalVelocity_))
+        pHerd.setRandomVelocitys(pIndex);
+}
+/////////////////////////////////////////////
+//Movement kernels on 100k sheeps, agent by agent against batched or closed form
+std::string runKernels(uint64_t pSeed)
+{
+    const int Agents = 100000;
+    const int Rounds = 50;
+    herd vSheeps = sheep::createHerd();
+    vSheeps.seed_ = pSeed;
+    vSheeps.reserve(Agents);
+    for (int vS = 0; vS < Agents; vS++)
+        sheep::add(vSheeps);
+    std::chrono::steady_clock::time_point vStart;
+    double vNs[4];
+
+    herd vMoved = vSheeps;
+    vStart = std::chrono::steady_clock::now();
+    for (int vR = 0; vR < Rounds; vR++)
+        for (int vS = 0; vS < Agents; vS++)
+            vMoved.move(vS);
+    vNs[0] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - vStart).count() / Rounds / Agents;
+    herd vBatched = vSheeps;
+    vStart = std::chrono::steady_clock::now();
+    for (int vR = 0; vR < Rounds; vR++)
+        vBatched.moveRange(0, Agents);
+    vNs[1] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - vStart).count() / Rounds / Agents;
+
+    //Targets across the field, as goToward and runAway give them
+    for (int vS = 0; vS < Agents; vS++)
+    {
+        vSheeps.xVelocity_[vS] = (int)(vSheeps.random(vS) % (2 * frame_width)) - frame_width;
+        vSheeps.yVelocity_[vS] = (int)(vSheeps.random(vS) % (2 * frame_height)) - frame_height;
+    }
+    herd vLooped = vSheeps;
+    vStart = std::chrono::steady_clock::now();
+    for (int vS = 0; vS < Agents; vS++)
+        adjustVelocitysLoop(vLooped, vS);
+    vNs[2] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - vStart).count() / Agents;
+    herd vClosed = vSheeps;
+    vStart = std::chrono::steady_clock::now();
+    for (int vS = 0; vS < Agents; vS++)
+        vClosed.adjustVelocitys(vS);
+    vNs[3] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - vStart).count() / Agents;
+
+    //Every column the kernels can write, a random velocity also moves the draws
+    bool vSame = vMoved.x_ == vBatched.x_ && vMoved.y_ == vBatched.y_
+        && vMoved.xVelocity_ == vBatched.xVelocity_ && vMoved.yVelocity_ == vBatched.yVelocity_
+        && vMoved.draws_ == vBatched.draws_ && vMoved.serial_ == vBatched.serial_
+        && vLooped.xVelocity_ == vClosed.xVelocity_ && vLooped.yVelocity_ == vClosed.yVelocity_
+        && vLooped.draws_ == vClosed.draws_ && vLooped.serial_ == vClosed.serial_;
+    std::ostringstream vJson;
+    vJson << "{\"agents\": " << Agents << ", \"move_ns_per_agent\": " << vNs[0] << ", \"move_range_ns_per_agent\": " << vNs[1]
+        << ", \"adjust_loop_ns_per_agent\": " << vNs[2] << ", \"adjust_closed_ns_per_agent\": " << vNs[3]
+        << ", \"same_results\": " << (vSame ? "true" : "false") << "}";
+    return vJson.str();
+}
+/////////////////////////////////////////////
+//What interact did before the typed store, every propertie and value looked up by name. Kept as the reference
+bool interactByName(movingObject& pO1, renderedObject& pO2)
+{
+    if (pO1.hasPropertie("wolf"))
+    {
+        if (pO2.hasPropertie("shepherd"))
+        {
+            if (pO1.getDistance(&pO2) < wolf::traits::FleeRadius)
+            {
+                pO1.addPropertie("scared");
+                pO1.runAway(&pO2);
+            }
+        }
+        else if (pO2.hasPropertie("prey"))
+        {
+            if (pO1.overlap(&pO2))
+            {
+                pO1.setValue("starveTick", pO1.getHerd()->now_ + wolf::traits::StarveDelay - 1);
+                return true;
+            }
+            if (!pO1.hasPropertie("scared"))
+            {
+                int distance = pO1.getDistance(&pO2);
+                if (pO1.getValue("preyDistance") == -1 || pO1.getValue("preyDistance") > distance)
+                {
+                    pO1.setValue("preyDistance", distance);
+                    pO1.goToward(&pO2);
+                }
+            }
+        }
+    }
+    else if (pO1.hasPropertie("sheep"))
+    {
+        int now = pO1.getHerd()->now_;
+        if (pO2.hasPropertie("wolf"))
+        {
+            if (pO1.getDistance(&pO2) < sheep::traits::FleeRadius)
+                pO1.runAway(&pO2);
+        }
+        else if (pO1.hasPropertie("male") && pO2.hasPropertie("female") && pO1.overlap(&pO2)
+            && pO1.getValue("procreateTick") <= now && pO2.getValue("procreateTick") <= now)
+        {
+            pO1.setValue("procreateTick", now + sheep::traits::ProcreateDelay);
+            pO2.setValue("procreateTick", now + sheep::traits::ProcreateDelay);
+            pO2.addPropertie("pregnant");
+        }
+    }
+    return false;
+}
+/////////////////////////////////////////////
+//Runs interact on every pair, by name or through the encounters. Returns the ns per pair
+double runPairs(herd& pSheeps, herd& pWolfs, herd& pShepherds, const std::vector<std::pair<int, int>>& pPairs, bool pByName)
+{
+    std::chrono::steady_clock::time_point vStart = std::chrono::steady_clock::now();
+    for (int vP = 0; vP < (int)pPairs.size(); vP++)
+    {
+        //The pair kind goes with its position, sheep-sheep, sheep-wolf, wolf-sheep and wolf-shepherd
+        int vFirst = pPairs[vP].first, vSecond = pPairs[vP].second;
+        sheep vSheep(&pSheeps, vFirst);
+        wolf vWolf(&pWolfs, vFirst % pWolfs.size());
+        movingObject& vO1 = (vP % 4 < 2 ? (movingObject&)vSheep : (movingObject&)vWolf);
+        sheep vOtherSheep(&pSheeps, vSecond);
+        wolf vOtherWolf(&pWolfs, vSecond % pWolfs.size());
+        shepherd vShepherd(&pShepherds, 0);
+        renderedObject& vO2 = (vP % 4 == 1 ? (renderedObject&)vOtherWolf : vP % 4 == 3 ? (renderedObject&)vShepherd : (renderedObject&)vOtherSheep);
+        if (!pByName)
+            vO1.interact(&vO2);
+        else if (interactByName(vO1, vO2))
+            vO2.addPropertie("dead");
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - vStart).count() / pPairs.size();
+}
+/////////////////////////////////////////////
+//interact on the same pairs, the string keyed lookups against the typed store and the encounters
+std::string runInteract(uint64_t pSeed)
+{
+    const int Sheeps = 2000;
+    const int Wolfs = 20;
+    const int Pairs = 1000000;
+    herd vSheeps = sheep::createHerd();
+    herd vWolfs = wolf::createHerd();
+    herd vShepherds = shepherd::createHerd();
+    vSheeps.seed_ = vWolfs.seed_ = vShepherds.seed_ = pSeed;
+    for (int vS = 0; vS < Sheeps; vS++)
+        sheep::add(vSheeps);
+    for (int vW = 0; vW < Wolfs; vW++)
+        wolf::add(vWolfs);
+    shepherd::add(vShepherds);
+    std::vector<std::pair<int, int>> vPairs(Pairs);
+    for (int vP = 0; vP < Pairs; vP++)
+        vPairs[vP] = { (int)(counterRandom::draw(pSeed, 0, 2 * vP) % Sheeps), (int)(counterRandom::draw(pSeed, 0, 2 * vP + 1) % Sheeps) };
+
+    herd vNamedSheeps = vSheeps, vNamedWolfs = vWolfs, vNamedShepherds = vShepherds;
+    double vNamedNs = runPairs(vNamedSheeps, vNamedWolfs, vNamedShepherds, vPairs, true);
+    double vTypedNs = runPairs(vSheeps, vWolfs, vShepherds, vPairs, false);
+
+    //Every column, as the snapshots save them
+    std::vector<char> vNamed, vTyped;
+    vNamedSheeps.save(vNamed);
+    vNamedWolfs.save(vNamed);
+    vSheeps.save(vTyped);
+    vWolfs.save(vTyped);
+    bool vSame = vNamed == vTyped;
+    std::ostringstream vJson;
+    vJson << "{\"pairs\": " << Pairs << ", \"by_name_ns_per_pair\": " << vNamedNs << ", \"typed_ns_per_pair\": " << vTypedNs
+        << ", \"same_results\": " << (vSame ? "true" : "false") << "}";
+    return vJson.str();
+}
+/////////////////////////////////////////////
+//One tick as it was when every agent was in one list : the sheeps, the wolves, the shepherd then the lambs,
+//each pair met both ways in that order. Kept as the reference of ground::makeInteract
+void tickPairwise(herd& pSheeps, herd& pWolfs, herd& pShepherds, uint32_t pLambSerial)
+{
+    std::vector<sheep> vSheeps;
+    std::vector<wolf> vWolfs;
+    std::vector<shepherd> vShepherds;
+    for (int vS = 0; vS < pSheeps.size(); vS++)
+        vSheeps.emplace_back(&pSheeps, vS);
+    for (int vW = 0; vW < pWolfs.size(); vW++)
+        vWolfs.emplace_back(&pWolfs, vW);
+    for (int vS = 0; vS < pShepherds.size(); vS++)
+        vShepherds.emplace_back(&pShepherds, vS);
+    auto vList = [&]() {
+        std::vector<movingObject*> vObjects;
+        for (sheep& vSheep : vSheeps)
+            if (pSheeps.serial_[vSheep.getIndex()] < pLambSerial)
+                vObjects.push_back(&vSheep);
+        for (wolf& vWolf : vWolfs)
+            vObjects.push_back(&vWolf);
+        for (shepherd& vShepherd : vShepherds)
+            vObjects.push_back(&vShepherd);
+        for (sheep& vSheep : vSheeps)
+            if (pSheeps.serial_[vSheep.getIndex()] >= pLambSerial)
+                vObjects.push_back(&vSheep);
+        return vObjects;
+    };
+    std::vector<movingObject*> vObjects = vList();
+    for (int vO1 = 0; vO1 < (int)vObjects.size(); vO1++)
+        for (int vO2 = vO1 + 1; vO2 < (int)vObjects.size(); vO2++)
+        {
+            vObjects[vO1]->interact(vObjects[vO2]);
+            vObjects[vO2]->interact(vObjects[vO1]);
+        }
+    for (int vS = 0; vS < pSheeps.size(); vS++)
+        sheep::update(pSheeps, vS);
+    for (int vW = 0; vW < pWolfs.size(); vW++)
+    {
+        wolf::update(pWolfs, vW);
+        if (pWolfs.getValue(vW, field::starveTick) <= pWolfs.now_)
+            pWolfs.addPropertie(vW, propertie::dead);
+    }
+    for (int vS = 0; vS < pShepherds.size(); vS++)
+        shepherd::move(pShepherds, vS, NULL);
+    pWolfs.removeIf(propertie::dead);
+    pSheeps.removeIf(propertie::dead);
+    vSheeps.resize(pSheeps.size(), sheep(&pSheeps, 0));
+    vWolfs.resize(pWolfs.size(), wolf(&pWolfs, 0));
+    //Every agent but the last one of the list gives birth
+    vObjects = vList();
+    for (int vO = 0; vO < (int)vObjects.size() - 1; vO++)
+        if (vObjects[vO]->getHerd() == &pSheeps && pSheeps.removePropertie(vObjects[vO]->getIndex(), propertie::pregnant))
+            sheep::add(pSheeps, pSheeps.x_[vObjects[vO]->getIndex()], pSheeps.y_[vObjects[vO]->getIndex()]);
+    for (herd* vHerd : { &pSheeps, &pWolfs, &pShepherds })
+        vHerd->now_++;
+}
+/////////////////////////////////////////////
+//Runs the ground and the pairwise reference side by side, tick by tick, on several thread counts
+std::string runPairwise(uint64_t pSeed, int& pFailures)
+{
+    const int Runs[][3] = { { 100, 3, 600 }, { 300, 5, 300 }, { 500, 10, 300 } };
+    std::ostringstream vJson;
+    vJson << "[";
+    for (int vR = 0; vR < 3; vR++)
+        for (int vThreads : { 1, 3 })
+        {
+            int vSheepCount = Runs[vR][0], vWolfCount = Runs[vR][1], vTicks = Runs[vR][2];
+            ground vGround(NULL, vThreads, pSeed);
+            herd vSheeps = sheep::createHerd();
+            herd vWolfs = wolf::createHerd();
+            herd vShepherds = shepherd::createHerd();
+            vSheeps.seed_ = vWolfs.seed_ = vShepherds.seed_ = pSeed;
+            for (int vS = 0; vS < vSheepCount; vS++)
+            {
+                vGround.addSheep();
+                sheep::add(vSheeps);
+            }
+            for (int vW = 0; vW < vWolfCount; vW++)
+            {
+                vGround.addWolf();
+                wolf::add(vWolfs);
+            }
+            vGround.addShepherd();
+            shepherd::add(vShepherds);
+            uint32_t vLambSerial = vSheeps.nextSerial_;
+            //Same populations and the same places after every tick
+            int vDiverged = -1;
+            for (int vT = 0; vT < vTicks && vDiverged == -1; vT++)
+            {
+                vGround.simulate();
+                tickPairwise(vSheeps, vWolfs, vShepherds, vLambSerial);
+                bool vSame = vGround.countObjects(propertie::sheep) == vSheeps.size() && vGround.countObjects(propertie::wolf) == vWolfs.size();
+                for (int vS = 0; vS < vSheeps.size() && vSame; vS++)
+                    vSame = vGround.getSheep(vS).getX() == vSheeps.x_[vS] && vGround.getSheep(vS).getY() == vSheeps.y_[vS];
+                for (int vW = 0; vW < vWolfs.size() && vSame; vW++)
+                    vSame = vGround.getWolf(vW).getX() == vWolfs.x_[vW] && vGround.getWolf(vW).getY() == vWolfs.y_[vW];
+                if (!vSame)
+                    vDiverged = vT;
+            }
+            if (vDiverged != -1)
+            {
+                std::cerr << "pairwise " << vSheepCount << " " << vWolfCount << " threads " << vThreads << " : differs at tick " << vDiverged << std::endl;
+                pFailures++;
+            }
+            vJson << (vR + vThreads > 1 ? ", " : "") << "{\"sheeps\": " << vSheepCount << ", \"wolfs\": " << vWolfCount << ", \"threads\": " << vThreads
+                << ", \"ticks\": " << vTicks << ", \"final_sheeps\": " << vSheeps.size() << ", \"final_wolfs\": " << vWolfs.size()
+                << ", \"same_results\": " << (vDiverged == -1 ? "true" : "false") << "}";
+        }
+    vJson << "]";
+    return vJson.str();
+}
+/////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    //Check args
+    std::string only;
+    std::string jsonPath;
+    std::vector<int> threads;
+    uint64_t seed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--scenario" && i + 1 < argc)
+            only = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            //A list such as 1,2,4,8 runs every scenario once per thread count
+            std::stringstream list(argv[++i]);
+            std::string count;
+            while (std::getline(list, count, ','))
+                threads.push_back(std::max(1, std::stoi(count)));
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = std::stoull(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else
+        {
+            std::cerr << "Usage : bench [--scenario name|kernels|interact|pairwise] [--threads 1,2,4] [--seed N] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+    if (threads.empty())
+        threads.push_back(std::max(1, (int)std::thread::hardware_concurrency()));
+
+    //Run, the JSON is written once everything is done
+    std::ostringstream json;
+    json << "{\"seed\": " << seed << ", \"scenarios\": [";
+    bool first = true;
+    int failures = 0;
+    for (const scenario& vScenario : Scenarios)
+    {
+        if (!only.empty() && only != vScenario.name_)
+            continue;
+        for (int vThreads : threads)
+        {
+            std::cerr << vScenario.name_ << " threads " << vThreads << std::endl;
+            long long allocations = 0;
+            json << (first ? "\n  " : ",\n  ") << runScenario(vScenario, vThreads, seed, allocations);
+            first = false;
+            //A warm tick must not allocate, the exit code makes it a check
+            if (allocations > 0)
+            {
+                std::cerr << vScenario.name_ << " : " << allocations << " allocations once warm" << std::endl;
+                failures++;
+            }
+        }
+    }
+    json << "\n]";
+    if (only.empty() || only == "kernels")
+        json << ",\n\"kernels\": " << runKernels(seed);
+    if (only.empty() || only == "interact")
+        json << ",\n\"interact\": " << runInteract(seed);
+    if (only.empty() || only == "pairwise")
+        json << ",\n\"pairwise\": " << runPairwise(seed, failures);
+    json << "}\n";
+    if (jsonPath.empty())
+        std::cout << json.str();
+    else
+        std::ofstream(jsonPath) << json.str();
+    return failures ? 2 : 0;
+}
@@ -0,0 +1,294 @@
+#include "Project_SDL1.h"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//*****************************************************************************
+// *********************************** GRID ***********************************
+//*****************************************************************************
+//Every combination of the listed values is run once per seed
+class parameterGrid
+{
+public:
+    std::vector<int> sheeps_;
+    std::vector<int> wolfs_;
+    std::vector<std::pair<int, int>> worlds_;
+    int ticks_;//Most ticks of a run
+    int seeds_;//Runs per combination
+    int limit_;//A run stops once it has more sheeps, 0 for no limit
+
+    parameterGrid();
+    bool load(const std::string& pPath, std::string& pError);
+};
+/////////////////////////////////////////////
+//One independent world
+class runSpec
+{
+public:
+    int combination_;
+    int sheeps_;
+    int wolfs_;
+    int worldWidth_;
+    int worldHeight_;
+    uint64_t seed_;
+};
+/////////////////////////////////////////////
+class runResult
+{
+public:
+    int ticks_;//Simulated, fewer than asked if the run stopped early
+    int finalSheeps_;
+    int finalWolfs_;
+    int peakSheeps_;
+    int sheepExtinction_;//Tick of the last sheep's death, -1 if they survived
+    int wolfExtinction_;
+    bool capped_;//Stopped by the limit
+};
+
+/////////////////////////////////////////////
+parameterGrid::parameterGrid()
+{
+    this->ticks_ = 3600;
+    this->seeds_ = 1;
+    this->limit_ = 0;
+}
+/////////////////////////////////////////////
+bool parameterGrid::load(const std::string& pPath, std::string& pError)
+{
+    //One key per line followed by its values, # starts a comment
+    std::ifstream vFile(pPath);
+    if (!vFile)
+    {
+        pError = "Could not read " + pPath;
+        return false;
+    }
+    std::string vLine;
+    int vLineNumber = 0;
+    while (std::getline(vFile, vLine))
+    {
+        vLineNumber++;
+        vLine = vLine.substr(0, vLine.find('#'));
+        std::istringstream vValues(vLine);
+        std::string vKey, vValue;
+        if (!(vValues >> vKey))
+            continue;
+        std::vector<std::string> vList;
+        while (vValues >> vValue)
+            vList.push_back(vValue);
+        try
+        {
+            if (vList.empty())
+                throw std::invalid_argument("no value");
+            if (vKey == "sheep")
+                for (const std::string& v : vList)
+                    this->sheeps_.push_back(std::stoi(v));
+            else if (vKey == "wolves")
+                for (const std::string& v : vList)
+                    this->wolfs_.push_back(std::stoi(v));
+            else if (vKey == "world")
+                for (const std::string& v : vList)
+                {
+                    size_t vCross = v.find('x');
+                    if (vCross == std::string::npos)
+                        throw std::invalid_argument("WIDTHxHEIGHT expected");
+                    this->worlds_.push_back({ std::stoi(v.substr(0, vCross)), std::stoi(v.substr(vCross + 1)) });
+                }
+            else if (vKey == "ticks")
+                this->ticks_ = std::stoi(vList[0]);
+            else if (vKey == "seeds")
+                this->seeds_ = std::stoi(vList[0]);
+            else if (vKey == "limit")
+                this->limit_ = std::stoi(vList[0]);
+            else
+                throw std::invalid_argument("unknown key " + vKey);
+        }
+        catch (const std::exception& vError)
+        {
+            pError = pPath + ":" + std::to_string(vLineNumber) + " : " + vError.what();
+            return false;
+        }
+    }
+    if (this->worlds_.empty())
+        this->worlds_.push_back({ frame_width, frame_height });
+    for (const std::pair<int, int>& vWorld : this->worlds_)
+        if (vWorld.first < 200 || vWorld.second < 200)
+        {
+            pError = "A world must be at least 200x200";
+            return false;
+        }
+    if (this->sheeps_.empty() || this->wolfs_.empty() || this->ticks_ <= 0 || this->seeds_ <= 0)
+    {
+        pError = "sheep and wolves need values, ticks and seeds must be positive";
+        return false;
+    }
+    return true;
+}
+
+//*****************************************************************************
+// ************************************ RUN ***********************************
+//*****************************************************************************
+//Headless and on a single thread : the worlds share nothing, the cores are shared between them
+runResult runOne(const runSpec& pSpec, const parameterGrid& pGrid)
+{
+    ground vGround(NULL, 1, pSpec.seed_);
+    vGround.setWorld(pSpec.worldWidth_, pSpec.worldHeight_);
+    vGround.reserve(pSpec.sheeps_ * 2, pSpec.wolfs_);
+    for (int vS = 0; vS < pSpec.sheeps_; vS++)
+        vGround.addSheep();
+    for (int vW = 0; vW < pSpec.wolfs_; vW++)
+        vGround.addWolf();
+    vGround.addShepherd();
+
+    runResult vResult = { 0, pSpec.sheeps_, pSpec.wolfs_, pSpec.sheeps_, pSpec.sheeps_ ? -1 : 0, pSpec.wolfs_ ? -1 : 0, false };
+    while (vResult.ticks_ < pGrid.ticks_)
+    {
+        vGround.simulate();
+        vResult.ticks_++;
+        const telemetryRecord& vRecord = vGround.getTelemetry();
+        vResult.finalSheeps_ = vRecord.sheeps_;
+        vResult.finalWolfs_ = vRecord.wolfs_;
+        vResult.peakSheeps_ = std::max(vResult.peakSheeps_, vRecord.sheeps_);
+        if (vRecord.sheeps_ == 0 && vResult.sheepExtinction_ == -1)
+            vResult.sheepExtinction_ = vRecord.tick_;
+        if (vRecord.wolfs_ == 0 && vResult.wolfExtinction_ == -1)
+            vResult.wolfExtinction_ = vRecord.tick_;
+        //Nothing left to happen, or too many to be worth following
+        if (vRecord.sheeps_ == 0 && vRecord.wolfs_ == 0)
+            break;
+        if (pGrid.limit_ > 0 && vRecord.sheeps_ > pGrid.limit_)
+        {
+            vResult.capped_ = true;
+            break;
+        }
+    }
+    return vResult;
+}
+/////////////////////////////////////////////
+//Mean of the values, -1 if there are none
+double mean(const std::vector<double>& pValues)
+{
+    double vSum = 0;
+    for (double vValue : pValues)
+        vSum += vValue;
+    return pValues.empty() ? -1 : vSum / pValues.size();
+}
+/////////////////////////////////////////////
+void writeSummary(std::ostream& pOut, const parameterGrid& pGrid, const std::vector<runSpec>& pRuns, const std::vector<runResult>& pResults)
+{
+    pOut << "sheep,wolves,world,runs,mean_final_sheep,min_final_sheep,max_final_sheep,mean_final_wolves,mean_peak_sheep,"
+        "sheep_extinct_share,wolves_extinct_share,mean_sheep_extinction_tick,mean_wolf_extinction_tick,capped_share\n";
+    //The runs of a combination are next to each other
+    for (size_t vFirst = 0; vFirst < pRuns.size(); vFirst += pGrid.seeds_)
+    {
+        const runSpec& vSpec = pRuns[vFirst];
+        std::vector<double> vFinalSheeps, vFinalWolfs, vPeaks, vSheepExtinctions, vWolfExtinctions;
+        int vCapped = 0;
+        for (size_t vR = vFirst; vR < vFirst + pGrid.seeds_; vR++)
+        {
+            const runResult& vResult = pResults[vR];
+            vFinalSheeps.push_back(vResult.finalSheeps_);
+            vFinalWolfs.push_back(vResult.finalWolfs_);
+            vPeaks.push_back(vResult.peakSheeps_);
+            if (vResult.sheepExtinction_ != -1)
+                vSheepExtinctions.push_back(vResult.sheepExtinction_);
+            if (vResult.wolfExtinction_ != -1)
+                vWolfExtinctions.push_back(vResult.wolfExtinction_);
+            vCapped += vResult.capped_;
+        }
+        pOut << vSpec.sheeps_ << "," << vSpec.wolfs_ << "," << vSpec.worldWidth_ << "x" << vSpec.worldHeight_ << "," << pGrid.seeds_
+            << "," << mean(vFinalSheeps) << "," << *std::min_element(vFinalSheeps.begin(), vFinalSheeps.end())
+            << "," << *std::max_element(vFinalSheeps.begin(), vFinalSheeps.end()) << "," << mean(vFinalWolfs) << "," << mean(vPeaks)
+            << "," << (double)vSheepExtinctions.size() / pGrid.seeds_ << "," << (double)vWolfExtinctions.size() / pGrid.seeds_
+            << "," << mean(vSheepExtinctions) << "," << mean(vWolfExtinctions) << "," << (double)vCapped / pGrid.seeds_ << "\n";
+    }
+}
+/////////////////////////////////////////////
+void writeRuns(std::ostream& pOut, const std::vector<runSpec>& pRuns, const std::vector<runResult>& pResults)
+{
+    pOut << "sheep,wolves,world,seed,ticks,final_sheep,final_wolves,peak_sheep,sheep_extinction_tick,wolf_extinction_tick,capped\n";
+    for (size_t vR = 0; vR < pRuns.size(); vR++)
+    {
+        const runSpec& vSpec = pRuns[vR];
+        const runResult& vResult = pResults[vR];
+        pOut << vSpec.sheeps_ << "," << vSpec.wolfs_ << "," << vSpec.worldWidth_ << "x" << vSpec.worldHeight_ << "," << vSpec.seed_
+            << "," << vResult.ticks_ << "," << vResult.finalSheeps_ << "," << vResult.finalWolfs_ << "," << vResult.peakSheeps_
+            << "," << vResult.sheepExtinction_ << "," << vResult.wolfExtinction_ << "," << (vResult.capped_ ? 1 : 0) << "\n";
+    }
+}
+/////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    //Check args
+    std::string gridPath;
+    std::string outPath;
+    std::string runsPath;
+    int threads = std::max(1, (int)std::thread::hardware_concurrency());
+    uint64_t seed = 0;
+    bool valid = true;
+    for (int i = 1; valid && i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            threads = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = std::stoull(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (arg == "--runs" && i + 1 < argc)
+            runsPath = argv[++i];
+        else if (gridPath.empty() && arg.compare(0, 2, "--") != 0)
+            gridPath = arg;
+        else
+            valid = false;
+    }
+    parameterGrid grid;
+    std::string error;
+    if (!valid || gridPath.empty())
+        error = "Usage : ensemble <grid file> [--threads N] [--seed N] [--out summary.csv] [--runs runs.csv]";
+    if (!error.empty() || !grid.load(gridPath, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    //Same seeds for every combination, so they are compared on the same draws
+    std::vector<runSpec> runs;
+    int combination = 0;
+    for (const std::pair<int, int>& world : grid.worlds_)
+        for (int sheeps : grid.sheeps_)
+            for (int wolfs : grid.wolfs_)
+            {
+                for (int s = 0; s < grid.seeds_; s++)
+                    runs.push_back({ combination, sheeps, wolfs, world.first, world.second, seed + s });
+                combination++;
+            }
+
+    //One world per task, a finished thread takes the next one
+    std::vector<runResult> results(runs.size());
+    std::atomic<int> done(0);
+    threadPool pool(threads);
+    pool.run((int)runs.size(), 1, [&](int pBegin, int pEnd, int, int) {
+        for (int r = pBegin; r < pEnd; r++)
+            results[r] = runOne(runs[r], grid);
+        int finished = ++done;
+        if (finished % std::max(1, (int)runs.size() / 20) == 0 || finished == (int)runs.size())
+            std::cerr << finished << "/" << runs.size() << " runs" << std::endl;
+    });
+
+    //Written once everything is done, in the order of the grid
+    if (outPath.empty())
+        writeSummary(std::cout, grid, runs, results);
+    else
+    {
+        std::ofstream out(outPath);
+        writeSummary(out, grid, runs, results);
+    }
+    if (!runsPath.empty())
+    {
+        std::ofstream out(runsPath);
+        writeRuns(out, runs, results);
+    }
+    return 0;
+}
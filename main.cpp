@@ -1,21 +1,72 @@
 #include "Project_SDL1.h"
 #include <string>
+#include <algorithm>
 int main(int argc, char* argv[]) 
 {
     //Check args
-    if (argc != 4){
+    settings options;
+    bool valid = (argc >= 4);
+    for (int i = 4; valid && i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--headless")
+            options.headless_ = true;
+        else if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+            options.threads_ = std::max(1, std::stoi(argv[++i]));
+        else if (std::string(argv[i]) == "--seed" && i + 1 < argc)
+            options.seed_ = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--profile" && i + 1 < argc)
+            options.profilePath_ = argv[++i];
+        else if (std::string(argv[i]) == "--overlay")
+            options.overlay_ = true;
+        else if (std::string(argv[i]) == "--renderer" && i + 1 < argc && (std::string(argv[i + 1]) == "surface" || std::string(argv[i + 1]) == "gpu"))
+            options.accelerated_ = (std::string(argv[++i]) == "gpu");
+        else if (std::string(argv[i]) == "--load" && i + 1 < argc)
+            options.loadPath_ = argv[++i];
+        else if (std::string(argv[i]) == "--save" && i + 1 < argc)
+            options.savePath_ = argv[++i];
+        else if (std::string(argv[i]) == "--telemetry" && i + 1 < argc)
+            options.telemetryPath_ = argv[++i];
+        else if (std::string(argv[i]) == "--assets" && i + 1 < argc)
+            options.assetsPath_ = argv[++i];
+        else if (std::string(argv[i]) == "--record" && i + 1 < argc)
+            options.recordPath_ = argv[++i];
+        else if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+            options.replayPath_ = argv[++i];
+        else if (std::string(argv[i]) == "--export" && i + 1 < argc)
+            options.exportPath_ = argv[++i];
+        else if (std::string(argv[i]) == "--world" && i + 1 < argc)
+        {
+            //WIDTHxHEIGHT, large enough for the biggest image
+            std::string size = argv[++i];
+            size_t cross = size.find('x');
+            valid = (cross != std::string::npos);
+            if (valid)
+            {
+                options.worldWidth_ = std::stoi(size.substr(0, cross));
+                options.worldHeight_ = std::stoi(size.substr(cross + 1));
+                valid = (options.worldWidth_ >= 200 && options.worldHeight_ >= 200);
+            }
+        }
+        else
+            valid = false;
+    }
+    if (!valid){
         throw std::runtime_error("Need three arguments - "
-        "<number of sheep> <number of wolves> <simulation time>\n");}
+        "<number of sheep> <number of wolves> <simulation time> [--headless] [--threads N] [--seed N] [--profile file.csv] [--overlay] [--renderer surface|gpu] [--world WIDTHxHEIGHT] [--load file] [--save file] [--telemetry file.csv|file.bin] [--assets file] [--record file] [--replay file] [--export file.png|file.qoi|file.y4m]\n");}
+    options.sheeps_ = std::stoul(argv[1]);
+    options.wolfs_ = std::stoul(argv[2]);
+    options.duration_ = std::stoul(argv[3]);
 
-    //Initialize SDL , Initialize PNG loading
-    if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO) < 0) 
+    //Initialize SDL , Initialize PNG loading. An export draws without any display
+    bool display = !options.headless_ && options.exportPath_.empty();
+    if (SDL_Init(display ? SDL_INIT_TIMER | SDL_INIT_VIDEO : SDL_INIT_TIMER) < 0)
         throw std::runtime_error("SDL_Init error");
     if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG))
         throw std::runtime_error("IMG_Init error");
 
     //Loop
-    application app = application(std::stoul(argv[1]), std::stoul(argv[2]));
-    app.loop(std::stoul(argv[3]));
+    application app(options);
+    app.loop(options.duration_);
 
     //End
     SDL_Quit();